@@ -91,7 +91,25 @@ SOURCES += main.cpp\
     gui/paramselector.cpp \
     models/nullclinemodel.cpp \
     models/jacobianmodel.cpp \
-    gui/jacobiangui.cpp
+    gui/jacobiangui.cpp \
+    generate/script/cfilejit.cpp \
+    memrep/jitmodel.cpp \
+    draw/samplering.cpp \
+    draw/samplehistory.cpp \
+    globals/workerpool.cpp \
+    memrep/ensemble.cpp \
+    file/mappedfile.cpp \
+    file/datfilein.cpp \
+    file/dsinfilein.cpp \
+    memrep/prefetchsource.cpp \
+    memrep/mappedsource.cpp \
+    memrep/textsource.cpp \
+    memrep/randsource.cpp \
+    memrep/dormandprince.cpp \
+    memrep/rosenbrock.cpp \
+    memrep/rungekutta.cpp \
+    memrep/exprnschedule.cpp \
+    memrep/modelprogram.cpp
 
 HEADERS  += gui/mainwindow.h \
     models/parammodel.h \
@@ -160,7 +178,28 @@ HEADERS  += gui/mainwindow.h \
     draw/usernullcline.h \
     models/nullclinemodel.h \
     models/jacobianmodel.h \
-    gui/jacobiangui.h
+    gui/jacobiangui.h \
+    generate/script/cfilejit.h \
+    memrep/jitmodel.h \
+    draw/samplering.h \
+    draw/samplehistory.h \
+    globals/workerpool.h \
+    memrep/ensemble.h \
+    file/mappedfile.h \
+    file/datfilein.h \
+    file/dsinfilein.h \
+    memrep/inputsource.h \
+    memrep/prefetchsource.h \
+    memrep/mappedsource.h \
+    memrep/textsource.h \
+    globals/philox.h \
+    memrep/randsource.h \
+    memrep/dormandprince.h \
+    memrep/diffsolver.h \
+    memrep/rosenbrock.h \
+    memrep/rungekutta.h \
+    memrep/exprnschedule.h \
+    memrep/modelprogram.h
 
 FORMS    += forms/mainwindow.ui \
     forms/aboutgui.ui \
@@ -6,9 +6,6 @@
 #include "variableview.h"
 #include "vectorfield.h"
 
-const uchar DrawBase::Packet::PP_READ = (uchar)1 << 0;
-const uchar DrawBase::Packet::TP_READ = (uchar)1 << 1;
-
 const int DrawBase::MAX_BUF_SIZE = 8 * 1024 * 1024;
 const int DrawBase::TP_WINDOW_LENGTH = 1000;
 
@@ -60,7 +57,7 @@ void DrawBase::QuickEval(const std::string& exprn)
 #endif
     std::lock_guard<std::mutex> lock(_mutex);
     for (auto& it : _parserMgrs)
-        it.QuickEval(exprn);
+        it.PostQuickEval(exprn);
 }
 
 void DrawBase::SetNeedRecompute(bool need_update_parser)
@@ -108,6 +105,15 @@ void DrawBase::SetSpecs(const MapStr& specs)
     for (auto it : specs)
         _specs[it.first] = it.second;
 }
+void DrawBase::UpdateParsers()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("DrawBase::UpdateParsers", std::this_thread::get_id());
+#endif
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto& it : _parserMgrs)
+        it.PostUpdate();
+}
 
 void* DrawBase::DataCopy() const
 {
@@ -267,10 +273,7 @@ void DrawBase::RecomputeIfNeeded()
     if (_needRecompute)
     {
         for (auto& it : _parserMgrs)
-        {
-            it.SetExpressions();
-            it.SetConditions();
-        }
+            it.Update();
         _needRecompute = false;
     }
 }
@@ -329,10 +332,13 @@ void DrawBase::InitParserMgrs(size_t num)
 #endif
     std::lock_guard<std::mutex> lock(_mutex);
     _parserMgrs.clear();
-    _parserMgrs = std::vector<ParserMgr>(num);
-//    _parserMgrs.resize(num);
-    for (auto& it : _parserMgrs)
-        it.InitializeFull();
+    if (num==0) return;
+    _parserMgrs.reserve(num);
+    _parserMgrs.emplace_back();
+    _parserMgrs.front().InitializeFull();
+    for (size_t i=1; i<num; ++i)
+        _parserMgrs.push_back( _parserMgrs.front() );
+            //Copies share the first one's program and start from its data, so only it parses
 }
 void DrawBase::FreezeNonUser()
 {
@@ -1,5 +1,9 @@
 #include "nullcline.h"
 
+const int Nullcline::MAX_LATTICE_WIDTH = 16 * 1024;
+const size_t Nullcline::MIN_CHUNK_SIZE = 256;
+const int Nullcline::TILES_PER_SLOT = 4;
+
 Nullcline::Nullcline(DSPlot* plot) : DrawBase(plot)
 {
 #ifdef DEBUG_FUNC
@@ -36,113 +40,338 @@ void Nullcline::ComputeData()
 
         const int xidx = Spec_toi("xidx"),
                 yidx = Spec_toi("yidx"),
-                resolution = Spec_toi("resolution")*2,
-                resolution2 = resolution*resolution;
-        InitParserMgrs(resolution2);
+                resolution = Spec_toi("resolution")*2;
+        const bool adaptive = IsSpec("adaptive") && Spec_tob("adaptive");
+
+        //In adaptive mode the grid is only the coarsest level; cells are halved until they
+        //are no bigger than min_cell_size, as a fraction of the axis range
+        int cell_size = 1;
+        if (adaptive)
+        {
+            const double min_cell_size = Spec_tod("min_cell_size");
+            while (1.0/((resolution-1)*cell_size) > min_cell_size
+                   && (resolution-1)*cell_size*2 < MAX_LATTICE_WIDTH)
+                cell_size *= 2;
+        }
 
         const double xmin = _modelMgr->Minimum(ds::INIT, xidx),
                 xmax = _modelMgr->Maximum(ds::INIT, xidx),
                 ymin = _modelMgr->Minimum(ds::INIT, yidx),
                 ymax = _modelMgr->Maximum(ds::INIT, yidx);
-        const double xinc = (xmax - xmin) / (double)(resolution-1),
-                yinc = (ymax - ymin) / (double)(resolution-1);
-
-        Record* record = new Record(resolution2);
-        double* x = record->x,
-                * y = record->y,
-                * xdiff = new double[resolution2],
-                * ydiff = new double[resolution2];
+        Lattice lattice;
+        lattice.width = (resolution-1)*cell_size + 1;
+        lattice.xmin = xmin;
+        lattice.ymin = ymin;
+        lattice.xinc = (xmax - xmin) / (double)(lattice.width-1);
+        lattice.yinc = (ymax - ymin) / (double)(lattice.width-1);
 
+        Record* record = new Record();
         try
         {
+            {
+                std::lock_guard<std::mutex> lock( Mutex() );
+                RecomputeIfNeeded();
+            }
+
+            std::vector<Segment> xsegs, ysegs;
+            if (adaptive)
+                AdaptiveSegments(lattice, cell_size, xidx, yidx, xsegs, ysegs);
+            else
+                UniformSegments(lattice, xidx, yidx, xsegs, ysegs);
+            record->xclines = JoinSegments(xsegs);
+            record->yclines = JoinSegments(ysegs);
+
             std::lock_guard<std::mutex> lock( Mutex() );
-            RecomputeIfNeeded();
-            for (int i=0; i<resolution; ++i)
-                for (int j=0; j<resolution; ++j)
-                {
-                    const double xij = i*xinc + xmin,
-                                yij = j*yinc + ymin;
-                    const int idx = i*resolution+j;
+            _packets.push_back(record);
+        }
+        catch (std::exception& e)
+        {
+            _log->AddExcept("Nullcline::ComputeData: " + std::string(e.what()));
+            throw (e);
+        }
 
-                    ParserMgr& parser_mgr = GetParserMgr(idx);
-                    const double* diffs = parser_mgr.ConstData(ds::DIFF);
+        emit ComputeComplete(1);
 
-                    parser_mgr.SetData(ds::DIFF, xidx, xij);
-                    parser_mgr.SetData(ds::DIFF, yidx, yij);
-                    parser_mgr.ParserEval(false);
-                    xdiff[idx] = diffs[xidx] - xij;
-                    ydiff[idx] = diffs[yidx] - yij;
+        }label:
+        std::this_thread::sleep_for( std::chrono::milliseconds(RemainingSleepMs()) );
+    }
 
-                    x[idx] = xij;
-                    y[idx] = yij;
-                }
+    if (DeleteOnFinish()) emit ReadyToDelete();
+}
+
+void Nullcline::AdaptiveSegments(const Lattice& lattice, int cell_size, int xidx, int yidx,
+                                 std::vector<Segment>& xsegs, std::vector<Segment>& ysegs)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("Nullcline::AdaptiveSegments", std::this_thread::get_id());
+#endif
+    //Cells are refined a level at a time, so each level's new corners can be evaluated in one
+    //parallel sweep.  Only cells whose corners change sign are kept, which means a contour
+    //that enters and leaves a coarse cell through the same edge can be missed.
+    const int width = lattice.width;
+    std::vector< std::pair<int,int> > cells; //Lower corners, in lattice points
+    for (int i=0; i<width-1; i+=cell_size)
+        for (int j=0; j<width-1; j+=cell_size)
+            cells.push_back( std::make_pair(i,j) );
 
-            double lastx, lasty;
-            std::vector< std::pair<int,int> >& xcross_h = record->xcross_h,
-                    & xcross_v = record->xcross_v,
-                    & ycross_h = record->ycross_h,
-                    & ycross_v = record->ycross_v;
-            std::unordered_set<int> xidx_set, yidx_set; //To avoid duplicates;
-            //The grid is being searched *column-wise*
-            for (int j=0; j<resolution; ++j)
+    std::unordered_map< long long, std::pair<double,double> > diffs; //xdiff, ydiff by point
+    while (!cells.empty())
+    {
+        std::vector<long long> new_pts;
+        for (const auto& it : cells)
+        {
+            const long long corners[4] = {
+                (long long)it.first*width + it.second,
+                (long long)(it.first+cell_size)*width + it.second,
+                (long long)(it.first+cell_size)*width + it.second+cell_size,
+                (long long)it.first*width + it.second+cell_size};
+            for (int k=0; k<4; ++k)
+                if (diffs.find(corners[k])==diffs.end())
+                    new_pts.push_back(corners[k]);
+        }
+        std::sort(new_pts.begin(), new_pts.end());
+        new_pts.erase( std::unique(new_pts.begin(), new_pts.end()), new_pts.end() );
+
+        const size_t num_pts = new_pts.size();
+        std::vector<double> x(num_pts), y(num_pts), xdiff(num_pts), ydiff(num_pts);
+        for (size_t k=0; k<num_pts; ++k)
+        {
+            x[k] = lattice.X(new_pts[k] / width);
+            y[k] = lattice.Y(new_pts[k] % width);
+        }
+        EvalPoints(num_pts, x.data(), y.data(), xdiff.data(), ydiff.data(), xidx, yidx);
+        for (size_t k=0; k<num_pts; ++k)
+            diffs[ new_pts[k] ] = std::make_pair(xdiff[k], ydiff[k]);
+
+        std::vector< std::pair<int,int> > next_cells;
+        const int half = cell_size/2;
+        for (const auto& it : cells)
+        {
+            const int i = it.first, j = it.second;
+            const int ci[4] = {i, i+cell_size, i+cell_size, i},
+                    cj[4] = {j, j, j+cell_size, j+cell_size};
+            double fx[4], fy[4];
+            for (int k=0; k<4; ++k)
             {
-                lastx = xdiff[j];
-                lasty = ydiff[j];
-                for (int i=0; i<resolution; ++i)
-                {
-                    const int idx = i*resolution+j;
-                    if (ds::sgn(lastx) != ds::sgn(xdiff[idx]))
-                    {
-                        xcross_v.push_back( std::make_pair(i,j) );
-                        xidx_set.insert(idx);
-                    }
-                    lastx = xdiff[idx];
-
-                    if (ds::sgn(lasty) != ds::sgn(ydiff[idx]))
-                    {
-                        ycross_v.push_back( std::make_pair(i,j) );
-                        yidx_set.insert(idx);
-                    }
-                    lasty = ydiff[idx];
-                }
+                const auto& f = diffs.at( (long long)ci[k]*width + cj[k] );
+                fx[k] = f.first;
+                fy[k] = f.second;
             }
+            if (!ChangesSign(fx) && !ChangesSign(fy)) continue;
 
-            //Switch indices so as to search row-wise
-            for (int i=0; i<resolution; ++i)
+            if (cell_size==1)
+            {
+                QPointF p[4];
+                for (int k=0; k<4; ++k)
+                    p[k] = QPointF(lattice.X(ci[k]), lattice.Y(cj[k]));
+                CellSegments(fx, p, i, j, width, xsegs);
+                CellSegments(fy, p, i, j, width, ysegs);
+            }
+            else
             {
-                lastx = xdiff[i*resolution];
-                lasty = ydiff[i*resolution];
-                for (int j=0; j<resolution; ++j)
+                next_cells.push_back( std::make_pair(i, j) );
+                next_cells.push_back( std::make_pair(i+half, j) );
+                next_cells.push_back( std::make_pair(i, j+half) );
+                next_cells.push_back( std::make_pair(i+half, j+half) );
+            }
+        }
+        cells.swap(next_cells);
+        cell_size = half;
+    }
+}
+
+bool Nullcline::ChangesSign(const double* f)
+{
+    const bool in = f[0]>0;
+    return (f[1]>0)!=in || (f[2]>0)!=in || (f[3]>0)!=in;
+}
+
+void Nullcline::EvalPoints(size_t num_pts, const double* x, const double* y,
+                           double* xdiff, double* ydiff, int xidx, int yidx)
+{
+    //Points are split into chunks, each evaluated in a single sweep by the ParserMgr of
+    //whichever slot picks it up
+    WorkerPool* pool = WorkerPool::Instance();
+    const size_t max_chunks = TILES_PER_SLOT * pool->NumSlots(),
+            chunk_size = std::max(MIN_CHUNK_SIZE, (num_pts + max_chunks - 1) / max_chunks),
+            num_chunks = (num_pts + chunk_size - 1) / chunk_size;
+    pool->Run(num_chunks, [&](size_t chunk, size_t slot)
+    {
+        const size_t begin = chunk*chunk_size,
+                num = std::min(chunk_size, num_pts - begin);
+        ParserMgr& parser_mgr = GetParserMgr(slot);
+        parser_mgr.BatchBegin(num);
+        parser_mgr.SetBatchData(ds::DIFF, xidx, x + begin);
+        parser_mgr.SetBatchData(ds::DIFF, yidx, y + begin);
+        parser_mgr.ParserEvalBatch();
+        const double* xnext = parser_mgr.BatchData(ds::DIFF, xidx),
+                * ynext = parser_mgr.BatchData(ds::DIFF, yidx);
+        for (size_t k=0; k<num; ++k)
+        {
+            xdiff[begin+k] = xnext[k] - x[begin+k];
+            ydiff[begin+k] = ynext[k] - y[begin+k];
+        }
+    });
+}
+
+void Nullcline::UniformSegments(const Lattice& lattice, int xidx, int yidx,
+                                std::vector<Segment>& xsegs, std::vector<Segment>& ysegs)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("Nullcline::UniformSegments", std::this_thread::get_id());
+#endif
+    WorkerPool* pool = WorkerPool::Instance();
+    const int resolution = lattice.width,
+            resolution2 = resolution*resolution;
+    std::vector<double> x(resolution2), y(resolution2), xdiff(resolution2), ydiff(resolution2);
+    for (int i=0; i<resolution; ++i)
+        for (int j=0; j<resolution; ++j)
+        {
+            const int idx = i*resolution+j;
+            x[idx] = lattice.X(i);
+            y[idx] = lattice.Y(j);
+        }
+    EvalPoints(resolution2, x.data(), y.data(), xdiff.data(), ydiff.data(), xidx, yidx);
+
+    //Tiles are runs of whole rows of cells.  Tiles are merged in order, so the contours don't
+    //depend on the scheduling.
+    const int max_tiles = TILES_PER_SLOT * (int)pool->NumSlots(),
+            tile_rows = (resolution + max_tiles - 1) / max_tiles,
+            num_tiles = (resolution + tile_rows - 1) / tile_rows;
+    std::vector<TileSegments> segments(num_tiles);
+    pool->Run(num_tiles, [&](size_t tile, size_t)
+    {
+        const int i0 = (int)tile*tile_rows,
+                i1 = std::min(i0 + tile_rows, resolution-1);
+        TileSegments& ts = segments[tile];
+        for (int i=i0; i<i1; ++i)
+            for (int j=0; j<resolution-1; ++j)
+            {
+                const int corners[4] = {i*resolution+j, (i+1)*resolution+j,
+                                        (i+1)*resolution+j+1, i*resolution+j+1};
+                double fx[4], fy[4];
+                QPointF p[4];
+                for (int k=0; k<4; ++k)
                 {
-                    const int idx = i*resolution+j;
-                    if (ds::sgn(lastx) != ds::sgn(xdiff[idx]) && xidx_set.count(idx)==0)
-                        xcross_h.push_back( std::make_pair(i,j) );
-                    lastx = xdiff[idx];
-
-                    if (ds::sgn(lasty) != ds::sgn(ydiff[idx]) && yidx_set.count(idx)==0)
-                        ycross_h.push_back( std::make_pair(i,j) );
-                    lasty = ydiff[idx];
+                    fx[k] = xdiff[corners[k]];
+                    fy[k] = ydiff[corners[k]];
+                    p[k] = QPointF(x[corners[k]], y[corners[k]]);
                 }
+                CellSegments(fx, p, i, j, resolution, ts.xsegs);
+                CellSegments(fy, p, i, j, resolution, ts.ysegs);
             }
+    });
+    for (const auto& it : segments)
+    {
+        xsegs.insert(xsegs.end(), it.xsegs.cbegin(), it.xsegs.cend());
+        ysegs.insert(ysegs.end(), it.ysegs.cbegin(), it.ysegs.cend());
+    }
+}
 
-            _packets.push_back(record);
+void Nullcline::CellSegments(const double* f, const QPointF* p, int i, int j, int width,
+                             std::vector<Segment>& segs)
+{
+    //Corners are a=(i,j), b=(i+1,j), c=(i+1,j+1), d=(i,j+1), and edges are numbered by their
+    //lower lattice point, even along i and odd along j
+    const bool in[4] = {f[0]>0, f[1]>0, f[2]>0, f[3]>0};
+    const int edges[4] = {2*(i*width+j), 2*((i+1)*width+j)+1,
+                          2*(i*width+j+1), 2*(i*width+j)+1}; //ab, bc, dc, ad
+    const int ends[4][2] = {{0,1}, {1,2}, {3,2}, {0,3}};
+
+    EdgePoint pts[4];
+    int crossed[4], num_crossed = 0;
+    for (int k=0; k<4; ++k)
+    {
+        const int e0 = ends[k][0], e1 = ends[k][1];
+        if (in[e0]==in[e1]) continue;
+        const double t = f[e0] / (f[e0] - f[e1]); //Linear interpolation of the zero
+        pts[k].edge = edges[k];
+        pts[k].pt = p[e0] + t*(p[e1] - p[e0]);
+        crossed[num_crossed++] = k;
+    }
+
+    if (num_crossed==2)
+        segs.push_back( {pts[crossed[0]], pts[crossed[1]]} );
+    else if (num_crossed==4)
+    {
+        //Saddle:  whichever diagonal shares the sign of the centre is taken to be connected
+        const bool centre_in = (f[0] + f[1] + f[2] + f[3]) > 0;
+        if (centre_in==in[0])
+        {
+            segs.push_back( {pts[0], pts[1]} ); //Cuts off b
+            segs.push_back( {pts[2], pts[3]} ); //Cuts off d
         }
-        catch (std::exception& e)
+        else
         {
-            _log->AddExcept("Nullcline::ComputeData: " + std::string(e.what()));
-            throw (e);
+            segs.push_back( {pts[3], pts[0]} ); //Cuts off a
+            segs.push_back( {pts[1], pts[2]} ); //Cuts off c
         }
+    }
+}
 
-        delete[] xdiff;
-        delete[] ydiff;
+std::vector<QPolygonF> Nullcline::JoinSegments(const std::vector<Segment>& segs)
+{
+    //Each crossed edge is shared by at most two cells, so the points form simple chains and
+    //loops
+    struct Node
+    {
+        QPointF pt;
+        int nbrs[2];
+        bool visited;
+    };
+    std::unordered_map<int, Node> nodes;
+    nodes.reserve(2*segs.size());
+    auto link = [&](const EdgePoint& from, const EdgePoint& to)
+    {
+        auto it = nodes.find(from.edge);
+        if (it==nodes.end())
+            it = nodes.insert( std::make_pair(from.edge, Node{from.pt, {-1, -1}, false}) ).first;
+        it->second.nbrs[ it->second.nbrs[0]==-1 ? 0 : 1 ] = to.edge;
+    };
+    for (const auto& it : segs)
+    {
+        link(it.a, it.b);
+        link(it.b, it.a);
+    }
 
-        emit ComputeComplete(1);
+    std::vector<QPolygonF> lines;
+    auto walk = [&](int start)
+    {
+        QPolygonF line;
+        int prev = -1, cur = start;
+        while (cur!=-1)
+        {
+            Node& node = nodes.at(cur);
+            line << node.pt;
+            node.visited = true;
+            const int next = node.nbrs[0]!=prev ? node.nbrs[0] : node.nbrs[1];
+            prev = cur;
+            cur = next;
+            if (cur==start)
+            {
+                line << nodes.at(start).pt; //Close the loop
+                break;
+            }
+            if (cur!=-1 && nodes.at(cur).visited) break;
+        }
+        lines.push_back(line);
+    };
 
-        }label:
-        std::this_thread::sleep_for( std::chrono::milliseconds(RemainingSleepMs()) );
-    }
+    //Open chains start at their ends; whatever is left over is loops.  Going through the
+    //segments rather than the map keeps the order deterministic.
+    for (int pass=0; pass<2; ++pass)
+        for (const auto& it : segs)
+        {
+            const int edges[2] = {it.a.edge, it.b.edge};
+            for (int k=0; k<2; ++k)
+            {
+                const Node& node = nodes.at(edges[k]);
+                if (!node.visited && (pass==1 || node.nbrs[1]==-1))
+                    walk(edges[k]);
+            }
+        }
 
-    if (DeleteOnFinish()) emit ReadyToDelete();
+    return lines;
 }
 
 void Nullcline::Initialize()
@@ -153,9 +382,8 @@ void Nullcline::Initialize()
     _colors = *static_cast< const std::vector<QColor>* >( OpaqueSpec("colors") );
     SetNeedRecompute(true);
     FreezeNonUser();
-    const int resolution = Spec_toi("resolution")*2,
-            resolution2 = resolution*resolution;
-    InitParserMgrs(resolution2);
+    InitParserMgrs( WorkerPool::Instance()->NumSlots() );
+        //One per worker slot, kept across passes; model changes reach them through Update
 }
 
 void Nullcline::MakePlotItems()
@@ -179,76 +407,28 @@ void Nullcline::MakePlotItems()
     ClearPlotItems();
 
     const size_t xidx = Spec_toi("xidx"),
-            yidx = Spec_toi("yidx"),
-            resolution2 = NumParserMgrs(),
-            resolution = (int)sqrt(resolution2);
-
-    const std::vector< std::pair<int,int> >& xcross_h = record->xcross_h,
-            & xcross_v = record->xcross_v,
-            & ycross_h = record->ycross_h,
-            & ycross_v = record->ycross_v;
-    const double* x = record->x,
-            * y = record->y;
-    const double xinc = record->xinc,
-            yinc = record->yinc;
-
-    const size_t xnum_pts_h = xcross_h.size(),
-            xnum_pts_v = xcross_v.size(),
-            ynum_pts_h = ycross_h.size(),
-            ynum_pts_v = ycross_v.size();
-
-    ReservePlotItems(xnum_pts_h + xnum_pts_v + ynum_pts_h + ynum_pts_v);
-
-    const QColor& xcolor = _colors.at(xidx+1);
-    for (size_t i=0; i<xnum_pts_h; ++i)
-    {
-        QwtSymbol *symbol = new QwtSymbol( QwtSymbol::Ellipse,
-            QBrush(xcolor), QPen(xcolor, 2), QSize(5, 5) );
-        QwtPlotMarker* marker = new QwtPlotMarker();
-        marker->setSymbol(symbol);
-        const int idx = xcross_h.at(i).first*resolution + xcross_h.at(i).second;
-        marker->setXValue(x[idx] + xinc/2.0);
-        marker->setYValue(y[idx]);
-        marker->setZ(-1);
-        AddPlotItem(marker);
-    }
-    for (size_t i=0; i<xnum_pts_v; ++i)
-    {
-        QwtSymbol *symbol = new QwtSymbol( QwtSymbol::Ellipse,
-            QBrush(xcolor), QPen(xcolor, 2), QSize(5, 5) );
-        QwtPlotMarker* marker = new QwtPlotMarker();
-        marker->setSymbol(symbol);
-        const int idx = xcross_v.at(i).first*resolution + xcross_v.at(i).second;
-        marker->setXValue(x[idx]);
-        marker->setYValue(y[idx] + yinc/2.0);
-        marker->setZ(-1);
-        AddPlotItem(marker);
-    }
+            yidx = Spec_toi("yidx");
+    ReservePlotItems(record->xclines.size() + record->yclines.size());
 
-    QColor ycolor = _colors.at(yidx+1);
-    for (size_t i=0; i<ynum_pts_h; ++i)
+    const QColor& xcolor = _colors.at(xidx+1),
+            & ycolor = _colors.at(yidx+1);
+    for (const auto& it : record->xclines)
     {
-        QwtSymbol *symbol = new QwtSymbol( QwtSymbol::Ellipse,
-            QBrush(ycolor), QPen(ycolor, 2), QSize(5, 5) );
-        QwtPlotMarker* marker = new QwtPlotMarker();
-        marker->setSymbol(symbol);
-        const int idx = ycross_h.at(i).first*resolution + ycross_h.at(i).second;
-        marker->setXValue(x[idx] + xinc/2.0);
-        marker->setYValue(y[idx]);
-        marker->setZ(-1);
-        AddPlotItem(marker);
+        QwtPlotCurve* curv = new QwtPlotCurve();
+        curv->setPen(xcolor, 2);
+        curv->setRenderHint(QwtPlotItem::RenderAntialiased, true);
+        curv->setSamples(it);
+        curv->setZ(-1);
+        AddPlotItem(curv);
     }
-    for (size_t i=0; i<ynum_pts_v; ++i)
+    for (const auto& it : record->yclines)
     {
-        QwtSymbol *symbol = new QwtSymbol( QwtSymbol::Ellipse,
-            QBrush(ycolor), QPen(ycolor, 2), QSize(5, 5) );
-        QwtPlotMarker* marker = new QwtPlotMarker();
-        marker->setSymbol(symbol);
-        const int idx = ycross_v.at(i).first*resolution + ycross_v.at(i).second;
-        marker->setXValue(x[idx]);
-        marker->setYValue(y[idx] + yinc/2.0);
-        marker->setZ(-1);
-        AddPlotItem(marker);
+        QwtPlotCurve* curv = new QwtPlotCurve();
+        curv->setPen(ycolor, 2);
+        curv->setRenderHint(QwtPlotItem::RenderAntialiased, true);
+        curv->setSamples(it);
+        curv->setZ(-1);
+        AddPlotItem(curv);
     }
 
     DrawBase::Initialize(); //Have to wait on this, since we don't know how many objects there
@@ -1,9 +1,10 @@
 #ifndef NULLCLINE_H
 #define NULLCLINE_H
 
-#include <unordered_set>
+#include <unordered_map>
 
 #include "drawbase.h"
+#include "../globals/workerpool.h"
 
 class Nullcline : public DrawBase
 {
@@ -23,24 +24,53 @@ class Nullcline : public DrawBase
         virtual int SleepMs() const { return 50; }
 
     private:
+        static const int MAX_LATTICE_WIDTH; //Keeps edge numbers within an int
+        static const size_t MIN_CHUNK_SIZE; //Smallest batch worth handing to a worker
+        static const int TILES_PER_SLOT; //More tiles than slots, so uneven tiles balance out
+
+        struct EdgePoint
+        {
+            int edge; //Lattice edge the contour crosses, which identifies the point
+            QPointF pt;
+        };
+        struct Segment
+        {
+            EdgePoint a, b;
+        };
+        struct TileSegments
+        {
+            std::vector<Segment> xsegs, ysegs;
+        };
+        struct Lattice
+        {
+            double X(long long i) const { return xmin + i*xinc; }
+            double Y(long long j) const { return ymin + j*yinc; }
+            double xmin, xinc, ymin, yinc;
+            int width; //Points along each axis
+        };
         struct Record
         {
-            Record(size_t num_) : num_elts(num_), x(new double[num_]), y(new double[num_])
-            {}
-            Record(const Record& rec) : num_elts(rec.num_elts), x(new double[num_elts]), y(new double[num_elts]),
-                xinc(rec.xinc), yinc(rec.yinc),
-                xcross_h(rec.xcross_h), xcross_v(rec.xcross_v), ycross_h(rec.ycross_h), ycross_v(rec.ycross_v)
-            {
-                memcpy(x, rec.x, num_elts*sizeof(double));
-                memcpy(y, rec.y, num_elts*sizeof(double));
-            }
-            ~Record() { delete[] x; delete[] y; }
-            const size_t num_elts;
-            double* x, * y;
-            double xinc, yinc;
-            std::vector< std::pair<int,int> > xcross_h, xcross_v, ycross_h, ycross_v;
+            std::vector<QPolygonF> xclines, yclines; //Contours of xdiff and ydiff
         };
 
+        static void CellSegments(const double* f, const QPointF* p, int i, int j, int width,
+                                 std::vector<Segment>& segs);
+            //Marching squares for lattice cell (i,j), whose corners (i,j), (i+1,j),
+            //(i+1,j+1), (i,j+1) have values f and positions p.  width is the lattice width,
+            //for numbering edges.
+        static bool ChangesSign(const double* f); //Over the four corners of a cell
+        static std::vector<QPolygonF> JoinSegments(const std::vector<Segment>& segs);
+
+        void AdaptiveSegments(const Lattice& lattice, int cell_size, int xidx, int yidx,
+                              std::vector<Segment>& xsegs, std::vector<Segment>& ysegs);
+            //Starts from cells of cell_size lattice points and subdivides the ones whose
+            //corners change sign down to single lattice cells
+        void EvalPoints(size_t num_pts, const double* x, const double* y,
+                        double* xdiff, double* ydiff, int xidx, int yidx);
+            //Evaluates the differentials at the points in parallel
+        void UniformSegments(const Lattice& lattice, int xidx, int yidx,
+                             std::vector<Segment>& xsegs, std::vector<Segment>& ysegs);
+
         std::vector<QColor> _colors;
         std::deque<Record*> _packets;
 };
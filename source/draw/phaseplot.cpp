@@ -1,7 +1,9 @@
 #include "phaseplot.h"
 
+const size_t PhasePlot::RING_SIZE = 1024 * 1024;
+
 PhasePlot::PhasePlot(DSPlot* plot) : DrawBase(plot),
-    _pastDVSampsCt(0), _pastIPSampsCt(0)
+    _pastDVSampsCt(0), _pastIPSampsCt(0), _ringConsumer(0)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("PhasePlot::PhasePlot", std::this_thread::get_id());
@@ -15,7 +17,6 @@ PhasePlot::~PhasePlot()
 #endif
     auto data = static_cast< std::tuple<std::deque<double>,DataVec,DataVec>* >( Data() );
     if (data) delete data;
-    for (auto it : _packets) delete it;
 }
 
 /*void* PhasePlot::DataCopy() const
@@ -36,15 +37,9 @@ PhasePlot::~PhasePlot()
 
 void* PhasePlot::DataCopy() const
 {
+    //The samples themselves are shared, not copied
     std::lock_guard<std::mutex> lock(Mutex());
-    std::deque<Packet*>* packets = new std::deque<Packet*>();
-    for (auto it : _packets)
-    {
-        if (!( it->read_flag & Packet::TP_READ))
-                packets->push_back( new Packet(*it) );
-        it->read_flag |= Packet::TP_READ;
-    }
-    return packets;
+    return new std::shared_ptr<SampleRing>(_ring);
 }
 
 int PhasePlot::SleepMs() const
@@ -72,21 +67,20 @@ void PhasePlot::ComputeData()
             * const vars = parser_mgr.ConstData(ds::VAR);
         //variables, differential equations, and initial conditions, all of which can invoke named
         //values
+    SampleRing& ring = *_ring;
 
     const bool is_recording = Spec_tob("is_recording");
+    const int save_mod_n = std::max(Spec_toi("save_mod_n"), 1);
 
-    QFile temp(ds::TEMP_FILE.c_str());
-    std::string output;
+    //Every save_mod_n'th step is recorded, counting across refreshes
+    DatFileOut recorder(ds::TEMP_DAT_FILE);
+    size_t record_ct = 0;
     if (is_recording)
     {
-        temp.open(QFile::WriteOnly | QFile::Text);
-        for (size_t i=0; i<(size_t)num_diffs; ++i)
-            output += _modelMgr->Model(ds::DIFF)->ShortKey(i) + "\t";
-        for (size_t i=0; i<(size_t)num_vars; ++i)
-            output += _modelMgr->Model(ds::VAR)->ShortKey(i) + "\t";
-        output += "\n";
-        temp.write(output.c_str());
-        temp.flush();
+        VecStr fields = _modelMgr->Model(ds::DIFF)->ShortKeys();
+        const VecStr vars_keys = _modelMgr->Model(ds::VAR)->ShortKeys();
+        fields.insert(fields.end(), vars_keys.cbegin(), vars_keys.cend());
+        recorder.Open(fields, save_mod_n);
     }
 
     while (DrawState()==DRAWING)
@@ -104,17 +98,12 @@ void PhasePlot::ComputeData()
                 ? ((double)steps_per_sec/_modelMgr->ModelStep()) / (double)SleepMs() + 0.5
                 : 100;
         if (num_steps==0) num_steps = 1;
-        if (num_steps>MAX_BUF_SIZE) num_steps = MAX_BUF_SIZE;
-        Packet* packet = new Packet(num_steps, num_diffs, num_vars);
-        double* pack_ip = packet->ip;
-        const std::vector<double*>& pack_diffs = packet->diffs,
-                pack_vars = packet->vars;
+        if (num_steps>(int)ring.MaxBatch()) num_steps = (int)ring.MaxBatch();
 
         //Go through each expression and evaluate them
         try
         {
             RecomputeIfNeeded();
-            if (is_recording) output.clear();
             for (int k=0; k<num_steps; ++k)
             {
                 parser_mgr.ParserEvalAndConds();
@@ -131,33 +120,21 @@ void PhasePlot::ComputeData()
                 for (int i=0; i<num_diffs; ++i)
                 {
                     double diffs_i = diffs[i];
-                    pack_diffs[i][k] = diffs_i;
+                    ring.Write(k, 1+i, diffs_i);
                     ip_k += diffs_i * diffs_i;
                 }
-                pack_ip[k] = ip_k;
+                ring.Write(k, 0, ip_k);
                 for (int i=0; i<num_vars; ++i)
-                    pack_vars[i][k] = vars[i];
+                    ring.Write(k, 1+num_diffs+i, vars[i]);
 
-                if (is_recording)
+                if (is_recording && record_ct++ % save_mod_n == 0)
                 {
-                    for (int i=0; i<num_diffs; ++i)
-                        output += std::to_string(diffs[i]) + "\t";
-                    for (int i=0; i<num_vars; ++i)
-                        output += std::to_string(vars[i]) + "\t";
-                    output += "\n";
-                    //Saving *every* sample is incredibly unwieldy--need a parameter to control
-                    //when to save values
+                    recorder.Write(diffs, num_diffs);
+                    recorder.Write(vars, num_vars);
                 }
             }
 
-            if (is_recording)
-            {
-                temp.write(output.c_str());
-                temp.flush();
-            }
-
-            std::lock_guard<std::mutex> lock( Mutex() );
-            _packets.push_back(packet);
+            ring.Publish(num_steps);
         }
         catch (mu::ParserError& e)
         {
@@ -171,10 +148,10 @@ void PhasePlot::ComputeData()
         } 
         SetSpec("pulse_steps_remaining", pulse_steps_remaining);
 
-        //A blowup will crash QwtPlot
+        //A blowup will crash QwtPlot.  NaN compares false, so it's caught separately.
         const double DMAX = std::numeric_limits<double>::max()/1e100;
         for (int i=0; i<num_diffs; ++i)
-            if (abs(diffs[i])>DMAX)
+            if (!std::isfinite(diffs[i]) || abs(diffs[i])>DMAX)
                 throw std::runtime_error("PhasePlot::ComputeData: model exploded");
 
         if (_makePlots)
@@ -186,22 +163,20 @@ void PhasePlot::ComputeData()
         std::this_thread::sleep_for( std::chrono::milliseconds(RemainingSleepMs()) );
     }
 
-    temp.close();
+    recorder.Close();
 }
 
 void PhasePlot::Initialize()
 {
-    const int num_diffs = (int)_modelMgr->Model(ds::DIFF)->NumPars();
-    while (!_packets.empty())
-    {
-        delete _packets.front();
-        _packets.pop_front();
-    }
+    const int num_diffs = (int)_modelMgr->Model(ds::DIFF)->NumPars(),
+            num_vars = (int)_modelMgr->Model(ds::VAR)->NumPars();
+    _ring = std::make_shared<SampleRing>(1+num_diffs+num_vars, RING_SIZE);
+    _ringConsumer = _ring->AddConsumer();
 
     _makePlots = Spec_tob("make_plots");
     if (_makePlots)
     {
-        _diffPts = DataVec(num_diffs);
+        _diffPts.Reset(num_diffs);
 
         QwtSymbol *symbol = new QwtSymbol( QwtSymbol::Ellipse,
             QBrush( Qt::yellow ), QPen( Qt::red, 2 ), QSize( 8, 8 ) );
@@ -230,68 +205,56 @@ void PhasePlot::MakePlotItems()
 //    QTime timer;
 //    timer.start();
 
-    //**********************Copy packet data into local variables
-    std::unique_lock<std::mutex> lock( Mutex() );
-    if (_packets.empty()) return;
-    for (auto it : _packets)
-    {
-        if (!(it->read_flag & Packet::PP_READ))
-        {
-            const size_t num_diffs = it->diffs.size(),
-                    num_samples = it->num_samples;
-            for (size_t i=0; i<num_diffs; ++i)
-                for (size_t k=0; k<num_samples; ++k)
-                    _diffPts[i].push_back( it->diffs.at(i)[k]);
-            it->read_flag |= Packet::PP_READ;
-        }
-    }
-
-        //Delete used packets
-    Packet* packet = _packets.front();
-    while ((packet->read_flag & Packet::TP_READ) && (packet->read_flag & Packet::PP_READ))
-    {
-        _packets.pop_front();
-        if (_packets.empty()) break;
-        packet = _packets.front();
-    }
-    lock.unlock();
+    //**********************Copy new samples into local variables
+    uint64_t begin;
+    const uint64_t end = _ring->Unread(_ringConsumer, &begin);
+    if (begin==end) return;
+    const size_t num_diffs = _diffPts.NumCols();
+    std::vector<double> rows((end-begin)*num_diffs);
+    for (uint64_t seq=begin; seq<end; ++seq)
+        for (size_t i=0; i<num_diffs; ++i)
+            rows[(seq-begin)*num_diffs + i] = _ring->Sample(1+i, seq);
+    const uint64_t intact = _ring->Release(_ringConsumer, begin, end);
+        //Anything before intact was overwritten by the compute thread while we copied
+    if (intact==end) return;
+    for (uint64_t seq=intact; seq<end; ++seq)
+        _diffPts.PushBack(&rows[(seq-begin)*num_diffs]);
     //**********************
 
     //Shrink the buffer if need be
-    const int num_diffs = _diffPts.size(),
-            xy_buf_over = (int)_diffPts.at(0).size() - MAX_BUF_SIZE;
-    if (xy_buf_over>0)
-        for (int i=0; i<num_diffs; ++i)
-            _diffPts[i].erase(_diffPts[i].begin(), _diffPts[i].begin()+xy_buf_over);
+    _diffPts.Shrink(MAX_BUF_SIZE);
 
     //Plot the current state vector
     const int xidx = Spec_toi("xidx"),
             yidx = Spec_toi("yidx");
-    const std::deque<double> diff_x = _diffPts.at(xidx),
-            diff_y = _diffPts.at(yidx);
-    _marker->setValue(diff_x.back(), _diffPts.at(yidx).back());
+    _marker->setValue(_diffPts.Back(xidx), _diffPts.Back(yidx));
 
     //Plot the history (the curve)
-    const int num_saved_pts = (int)diff_x.size();
+    const int num_saved_pts = (int)_diffPts.Size();
     int tail_len = std::min( num_saved_pts, Spec_toi("tail_length") );
     if (tail_len==-1) tail_len = num_saved_pts;
-    const int inc = tail_len < SamplesShown()/2
-            ? 1
-            : tail_len / (SamplesShown()/2);
-    const int num_drawn_pts = tail_len / inc;
+    const int ct_begin = std::max(0,num_saved_pts-tail_len);
+
+        //Long tails are decimated by keeping, in each stretch of the tail, the points where x
+        //and y reach their extremes, so excursions aren't lost
+    std::vector<size_t> xrows, yrows, rows;
+    const size_t num_buckets = SamplesShown()/4;
+    _diffPts.Envelope(xidx, ct_begin, num_saved_pts, num_buckets, xrows);
+    _diffPts.Envelope(yidx, ct_begin, num_saved_pts, num_buckets, yrows);
+    std::set_union(xrows.cbegin(), xrows.cend(), yrows.cbegin(), yrows.cend(),
+                   std::back_inserter(rows));
+    const size_t num_drawn_pts = rows.size();
     QPolygonF points(num_drawn_pts);
-
-    int ct_begin = std::max(0,num_saved_pts-tail_len);
-    for (int k=0, ct=ct_begin; k<num_drawn_pts; ++k, ct+=inc)
-        points[k] = QPointF(diff_x[ct], diff_y[ct]);
+    for (size_t k=0; k<num_drawn_pts; ++k)
+        points[k] = QPointF(_diffPts.At(xidx, rows[k]), _diffPts.At(yidx, rows[k]));
     _curve->setSamples(points);
 
-    auto xlims = std::minmax_element(diff_x.cbegin(), diff_x.cend()),
-            ylims = std::minmax_element(diff_y.cbegin(), diff_y.cend());
-    const double xmin = *xlims.first,
-            xmax = *xlims.second,
-            ymin = *ylims.first,
-            ymax = *ylims.second;
+    const auto xlims = _diffPts.MinMax(xidx, 0, num_saved_pts),
+            ylims = _diffPts.MinMax(yidx, 0, num_saved_pts);
+    const double xmin = xlims.first,
+            xmax = xlims.second,
+            ymin = ylims.first,
+            ymax = ylims.second;
     SetSpec("xmin", xmin);
     SetSpec("xmax", xmax);
     SetSpec("ymin", ymin);
@@ -300,9 +263,3 @@ void PhasePlot::MakePlotItems()
 //    std::cerr << "PhasePlot::MakeItems: " << std::to_string( timer.elapsed() );
 }
 
-int PhasePlot::PacketSampCt() const
-{
-    int sum = 0;
-    for (const auto& it : _packets) sum += it->num_samples;
-    return sum;
-}
@@ -1,7 +1,11 @@
 #ifndef PHASEPLOT_H
 #define PHASEPLOT_H
 
+#include <cmath>
+#include <iterator>
+
 #include "drawbase.h"
+#include "../file/datfileout.h"
 
 class PhasePlot : public DrawBase
 {
@@ -22,14 +26,17 @@ class PhasePlot : public DrawBase
         virtual void Initialize() override;
 
     private:
-        int PacketSampCt() const;
+        static const size_t RING_SIZE;
 
         QwtPlotCurve* _curve;
-        DataVec _diffPts;
+        SampleHistory _diffPts;
         bool _makePlots;
         QwtPlotMarker* _marker;
-        std::deque<Packet*> _packets;
         int _pastDVSampsCt, _pastIPSampsCt; //Samples outside the buffer
+        std::shared_ptr<SampleRing> _ring;
+            //Channel 0 is the inner product, followed by the differentials and the variables.
+            //Shared with the time plot.
+        size_t _ringConsumer;
 };
 
 #endif // PHASEPLOT_H
@@ -0,0 +1,228 @@
+#include "samplehistory.h"
+
+const size_t SampleHistory::CHUNK_SIZE;
+const size_t SampleHistory::CHUNK_MASK;
+const size_t SampleHistory::LOD_FACTOR = 16;
+const size_t SampleHistory::MAX_SPARE = 2;
+const size_t SampleHistory::NUM_LOD_LEVELS = 6; //Top blocks are 16M rows, > MAX_BUF_SIZE
+
+SampleHistory::SampleHistory(size_t num_cols)
+    : _evicted(0), _front(0), _numCols(num_cols), _size(0)
+{
+    InitLod();
+}
+SampleHistory::~SampleHistory()
+{
+    for (auto it : _chunks) delete[] it;
+    for (auto it : _spare) delete[] it;
+}
+
+void SampleHistory::Clear()
+{
+    PopFront(_size);
+}
+void SampleHistory::PopBack(size_t num_rows)
+{
+    if (num_rows>_size)
+        throw std::out_of_range("SampleHistory::PopBack: Not enough rows");
+    _size -= num_rows;
+    const size_t num_chunks = (_front + _size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    while (_chunks.size()>num_chunks)
+    {
+        Recycle(_chunks.back());
+        _chunks.pop_back();
+    }
+    if (_size==0) _front = 0;
+    LodPopBack();
+}
+void SampleHistory::PopFront(size_t num_rows)
+{
+    if (num_rows>_size)
+        throw std::out_of_range("SampleHistory::PopFront: Not enough rows");
+    _evicted += num_rows;
+    _front += num_rows;
+    _size -= num_rows;
+    while (_front>=CHUNK_SIZE || (_size==0 && !_chunks.empty()))
+    {
+        Recycle(_chunks.front());
+        _chunks.pop_front();
+        _front = _front>=CHUNK_SIZE ? _front - CHUNK_SIZE : 0;
+    }
+    if (_size==0) _front = 0;
+    LodPopFront();
+}
+void SampleHistory::Reset(size_t num_cols)
+{
+    Clear();
+    if (num_cols!=_numCols)
+    {
+        for (auto it : _spare) delete[] it;
+        _spare.clear();
+        _numCols = num_cols;
+    }
+    InitLod();
+}
+void SampleHistory::Shrink(size_t max_rows)
+{
+    if (_size>max_rows) PopFront(_size - max_rows);
+}
+
+std::pair<double,double> SampleHistory::Envelope(size_t col, size_t begin, size_t end,
+                                                 size_t num_buckets, std::vector<size_t>& rows) const
+{
+    Extrema total = EmptyExtrema();
+    if (begin>=end) return std::make_pair(total.min, total.max);
+    const size_t num_rows = end - begin,
+            num_b = std::max(num_buckets, (size_t)1),
+            bucket = (num_rows + num_b - 1) / num_b;
+    for (size_t a=begin; a<end; a+=bucket)
+    {
+        const size_t e = std::min(a+bucket, end);
+        const Extrema ex = RangeExtrema(col, a, e);
+        Include(total, ex);
+        if (bucket<=2)
+        {
+            for (size_t r=a; r<e; ++r) rows.push_back(r);
+            continue;
+        }
+        if (ex.min>ex.max) //Nothing but NaN, so there are no extremes to point at
+        {
+            rows.push_back(a);
+            rows.push_back(e-1);
+            continue;
+        }
+        const size_t rmin = (size_t)(ex.imin - _evicted),
+                rmax = (size_t)(ex.imax - _evicted);
+        rows.push_back( std::min(rmin, rmax) );
+        if (rmin!=rmax) rows.push_back( std::max(rmin, rmax) );
+    }
+    return std::make_pair(total.min, total.max);
+}
+std::pair<double,double> SampleHistory::MinMax(size_t col, size_t begin, size_t end) const
+{
+    const Extrema ex = RangeExtrema(col, begin, end);
+    return std::make_pair(ex.min, ex.max);
+}
+
+SampleHistory::Extrema SampleHistory::EmptyExtrema()
+{
+#ifdef __GNUC__
+    const Extrema ex = {std::numeric_limits<double>::max(), -std::numeric_limits<double>::max(), 0, 0};
+#else
+    Extrema ex; ex.min = std::numeric_limits<double>::max(); ex.max = -ex.min; ex.imin = ex.imax = 0;
+#endif
+    return ex;
+}
+
+void SampleHistory::InitLod()
+{
+    _lod = std::vector<LodLevel>(NUM_LOD_LEVELS);
+    uint64_t block_size = 1;
+    for (auto& it : _lod)
+    {
+        block_size *= LOD_FACTOR;
+        it.block_size = block_size;
+        it.first = 0;
+    }
+}
+void SampleHistory::LodPopBack()
+{
+    if (_numCols==0) return;
+    const uint64_t end = _evicted + _size;
+    for (auto& level : _lod)
+    {
+        while (!level.blocks.empty()
+               && (level.first + level.blocks.size()/_numCols - 1)*level.block_size >= end)
+            level.blocks.erase(level.blocks.end() - _numCols, level.blocks.end());
+        if (level.blocks.empty() || end % level.block_size == 0) continue;
+
+        //The last block lost rows, so rebuild it; the lower levels are already up to date
+        const uint64_t last = level.first + level.blocks.size()/_numCols - 1,
+                start = std::max(last*level.block_size, _evicted);
+        const size_t base = level.blocks.size() - _numCols;
+        for (size_t i=0; i<_numCols; ++i)
+            level.blocks[base+i] = RangeExtrema(i, (size_t)(start - _evicted), _size);
+    }
+}
+void SampleHistory::LodPopFront()
+{
+    if (_numCols==0) return;
+    for (auto& level : _lod)
+        while (!level.blocks.empty() && (level.first+1)*level.block_size <= _evicted)
+        {
+            level.blocks.erase(level.blocks.begin(), level.blocks.begin() + _numCols);
+            ++level.first;
+        }
+}
+void SampleHistory::LodPushBack(const double* row)
+{
+    if (_numCols==0) return;
+    const uint64_t abs_row = _evicted + _size;
+    for (auto& level : _lod)
+    {
+        const uint64_t block = abs_row / level.block_size;
+        const size_t num_blocks = level.blocks.size() / _numCols;
+        if (num_blocks==0 || level.first + num_blocks <= block)
+        {
+            if (num_blocks==0) level.first = block;
+            for (size_t i=0; i<_numCols; ++i)
+            {
+                Extrema ex = EmptyExtrema();
+                Include(ex, row[i], abs_row);
+                level.blocks.push_back(ex);
+            }
+        }
+        else
+        {
+            const size_t base = level.blocks.size() - _numCols;
+            for (size_t i=0; i<_numCols; ++i)
+                Include(level.blocks[base+i], row[i], abs_row);
+        }
+    }
+}
+
+double* SampleHistory::NewChunk()
+{
+    if (_spare.empty()) return new double[_numCols*CHUNK_SIZE];
+    double* chunk = _spare.back();
+    _spare.pop_back();
+    return chunk;
+}
+
+SampleHistory::Extrema SampleHistory::RangeExtrema(size_t col, size_t begin, size_t end) const
+{
+    //Greedily cover the range with the largest aligned blocks that fit, falling back on
+    //single rows at the ragged edges
+    Extrema ex = EmptyExtrema();
+    uint64_t a = _evicted + begin;
+    const uint64_t e = _evicted + end;
+    while (a<e)
+    {
+        bool is_covered = false;
+        for (size_t l=_lod.size(); l-->0; )
+        {
+            const LodLevel& level = _lod[l];
+            if (a % level.block_size != 0 || a + level.block_size > e) continue;
+            const uint64_t block = a / level.block_size;
+            if (block<level.first || block>=level.first + level.blocks.size()/_numCols) continue;
+            Include(ex, level.blocks[(block - level.first)*_numCols + col]);
+            a += level.block_size;
+            is_covered = true;
+            break;
+        }
+        if (!is_covered)
+        {
+            Include(ex, At(col, (size_t)(a - _evicted)), a);
+            ++a;
+        }
+    }
+    return ex;
+}
+
+void SampleHistory::Recycle(double* chunk)
+{
+    if (_spare.size()<MAX_SPARE)
+        _spare.push_back(chunk);
+    else
+        delete[] chunk;
+}
@@ -0,0 +1,137 @@
+#ifndef SAMPLEHISTORY_H
+#define SAMPLEHISTORY_H
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+//Columnar history of samples, each row holding one value per column.  Rows are stored in
+//fixed-size chunks, and within a chunk each column is contiguous, so a column can be read as a
+//handful of spans and old rows can be dropped from the front in constant time without moving
+//anything.  A few freed chunks are kept for reuse, so a history that is trimmed as fast as it
+//grows stops allocating.
+//  Alongside the rows the history keeps a min/max pyramid:  level l holds, for each aligned
+//block of LOD_FACTOR^(l+1) rows, the extremes of every column and the rows they occur on.
+//The pyramid is updated as rows arrive and leave, so extremes over any range, and
+//envelope-preserving decimations of any window, cost about as much as the number of pieces
+//asked for rather than the number of rows.
+class SampleHistory
+{
+    public:
+        static const size_t CHUNK_SIZE = 64 * 1024; //Rows per chunk; a power of 2
+        static const size_t LOD_FACTOR, NUM_LOD_LEVELS;
+
+        SampleHistory(size_t num_cols = 0);
+        ~SampleHistory();
+#ifdef __GNUG__
+        SampleHistory(const SampleHistory&) = delete;
+        SampleHistory& operator=(const SampleHistory&) = delete;
+#endif
+
+        void Clear();
+        void PopBack(size_t num_rows);
+        void PopFront(size_t num_rows);
+        inline void PushBack(const double* row);
+        void Reset(size_t num_cols);
+        void Shrink(size_t max_rows); //Drops rows from the front down to max_rows
+
+        inline double At(size_t col, size_t row) const;
+        double Back(size_t col) const { return At(col, _size-1); }
+        bool Empty() const { return _size==0; }
+        template<typename F>
+        void ForEachSpan(size_t col, size_t begin, size_t end, F func) const;
+            //Calls func(const double* vals, size_t num) on contiguous pieces of rows [begin, end)
+        std::pair<double,double> Envelope(size_t col, size_t begin, size_t end,
+                                          size_t num_buckets, std::vector<size_t>& rows) const;
+            //Splits rows [begin, end) into about num_buckets buckets and appends the rows on
+            //which col reaches its minimum and maximum in each bucket to rows, in order.
+            //Returns the minimum and maximum over the whole range.
+        std::pair<double,double> MinMax(size_t col, size_t begin, size_t end) const;
+        size_t NumCols() const { return _numCols; }
+        size_t Size() const { return _size; }
+
+    private:
+        static const size_t CHUNK_MASK = CHUNK_SIZE - 1;
+        static const size_t MAX_SPARE;
+
+        struct Extrema
+        {
+            double min, max;
+            uint64_t imin, imax; //Absolute row numbers, i.e. counting evicted rows
+        };
+        struct LodLevel
+        {
+            uint64_t block_size, first; //first is the block number of blocks.front()
+            std::deque<Extrema> blocks; //NumCols() entries per block
+        };
+
+        static Extrema EmptyExtrema();
+
+        inline void Include(Extrema& ex, double val, uint64_t row) const;
+        void InitLod();
+        inline void Include(Extrema& ex, const Extrema& other) const;
+        void LodPopBack();
+        void LodPopFront();
+        void LodPushBack(const double* row);
+        double* NewChunk();
+        Extrema RangeExtrema(size_t col, size_t begin, size_t end) const;
+        void Recycle(double* chunk);
+
+        std::deque<double*> _chunks;
+        uint64_t _evicted; //Rows ever dropped from the front
+        size_t _front; //Offset of row 0 in the first chunk
+        std::vector<LodLevel> _lod;
+        size_t _numCols;
+        size_t _size;
+        std::vector<double*> _spare;
+};
+
+void SampleHistory::PushBack(const double* row)
+{
+    const size_t pos = _front + _size;
+    if (pos/CHUNK_SIZE == _chunks.size())
+        _chunks.push_back( NewChunk() );
+    double* chunk = _chunks.back();
+    const size_t idx = pos & CHUNK_MASK;
+    for (size_t i=0; i<_numCols; ++i)
+        chunk[i*CHUNK_SIZE + idx] = row[i];
+    LodPushBack(row);
+    ++_size;
+}
+
+double SampleHistory::At(size_t col, size_t row) const
+{
+    const size_t pos = _front + row;
+    return _chunks[pos / CHUNK_SIZE][col*CHUNK_SIZE + (pos & CHUNK_MASK)];
+}
+
+template<typename F>
+void SampleHistory::ForEachSpan(size_t col, size_t begin, size_t end, F func) const
+{
+    size_t pos = _front + begin;
+    const size_t last = _front + end;
+    while (pos<last)
+    {
+        const size_t idx = pos & CHUNK_MASK,
+                num = std::min(CHUNK_SIZE - idx, last - pos);
+        func(_chunks[pos / CHUNK_SIZE] + col*CHUNK_SIZE + idx, num);
+        pos += num;
+    }
+}
+
+void SampleHistory::Include(Extrema& ex, double val, uint64_t row) const
+{
+    if (val<ex.min) { ex.min = val; ex.imin = row; }
+    if (val>ex.max) { ex.max = val; ex.imax = row; }
+}
+void SampleHistory::Include(Extrema& ex, const Extrema& other) const
+{
+    if (other.min<ex.min) { ex.min = other.min; ex.imin = other.imin; }
+    if (other.max>ex.max) { ex.max = other.max; ex.imax = other.imax; }
+}
+
+#endif // SAMPLEHISTORY_H
@@ -0,0 +1,70 @@
+#include "samplering.h"
+
+const size_t SampleRing::MAX_CONSUMERS;
+
+SampleRing::SampleRing(size_t num_channels, size_t min_capacity)
+    : _capacity(RoundUpPow2(min_capacity)), _mask(_capacity-1),
+      _data(num_channels*_capacity), _head(0), _numChannels(num_channels), _writeHead(0)
+{
+    for (size_t i=0; i<MAX_CONSUMERS; ++i)
+    {
+        _cursors[i] = 0;
+        _inUse[i] = false;
+    }
+}
+
+void SampleRing::Publish(size_t num_samps)
+{
+    _writeHead += num_samps;
+    _head.store(_writeHead, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+        //A consumer that sees any of the next batch's writes also sees this head
+}
+
+size_t SampleRing::AddConsumer()
+{
+    for (size_t i=0; i<MAX_CONSUMERS; ++i)
+    {
+        bool expected = false;
+        if (_inUse[i].compare_exchange_strong(expected, true))
+        {
+            _cursors[i] = Oldest( Head() ); //New consumers get whatever history is still intact
+            return i;
+        }
+    }
+    throw std::runtime_error("SampleRing::AddConsumer: Too many consumers");
+}
+uint64_t SampleRing::Release(size_t consumer, uint64_t begin, uint64_t end)
+{
+    std::atomic_thread_fence(std::memory_order_acquire); //Keeps the copy before the re-read
+    const uint64_t oldest = Oldest( _head.load(std::memory_order_relaxed) );
+    _cursors[consumer].store(end, std::memory_order_relaxed);
+    return std::min(std::max(begin, oldest), end);
+}
+void SampleRing::RemoveConsumer(size_t consumer)
+{
+    _inUse[consumer] = false;
+}
+void SampleRing::ResetConsumer(size_t consumer)
+{
+    _cursors[consumer] = Head();
+}
+uint64_t SampleRing::Unread(size_t consumer, uint64_t* begin) const
+{
+    const uint64_t end = Head();
+    *begin = std::max(_cursors[consumer].load(std::memory_order_relaxed), Oldest(end));
+    return end;
+}
+
+size_t SampleRing::RoundUpPow2(size_t n)
+{
+    size_t pow2 = 1;
+    while (pow2<n) pow2 <<= 1;
+    return pow2;
+}
+
+uint64_t SampleRing::Oldest(uint64_t head) const
+{
+    const uint64_t reach = head + MaxBatch();
+    return reach>_capacity ? reach - _capacity : 0;
+}
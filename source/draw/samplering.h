@@ -0,0 +1,71 @@
+#ifndef SAMPLERING_H
+#define SAMPLERING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+//A preallocated single-producer, multiple-consumer ring of samples, each sample holding one
+//value per channel.  Each channel is stored contiguously, and consumers read the samples in
+//place.
+//  The producer never waits on anybody:  it writes ahead of the published head and overwrites
+//the oldest samples.  Each consumer keeps its own cursor, and a consumer that falls more than
+//Capacity()-MaxBatch() samples behind simply loses the samples it missed.
+class SampleRing
+{
+    public:
+        static const size_t MAX_CONSUMERS = 4;
+
+        SampleRing(size_t num_channels, size_t min_capacity);
+#ifdef __GNUG__
+        SampleRing(const SampleRing&) = delete;
+        SampleRing& operator=(const SampleRing&) = delete;
+#endif
+
+        //Producer:  Write fills in sample Head()+offset, and Publish makes the next num_samps
+        //samples visible to the consumers.  At most MaxBatch() samples can be written between
+        //publications.
+        inline void Write(size_t offset, size_t channel, double val)
+        {
+            _data[channel*_capacity + ((_writeHead+offset) & _mask)] = val;
+        }
+        void Publish(size_t num_samps);
+
+        //Consumers:  Unread gives the range [begin, end) not yet read by the consumer, values
+        //are copied out with Sample, and Release advances the cursor past them.  Release
+        //re-reads the head after the copy, seqlock style, and returns the first sample of the
+        //range that is still intact; whatever was copied before it was overwritten during the
+        //read and should be discarded.
+        size_t AddConsumer();
+        uint64_t Release(size_t consumer, uint64_t begin, uint64_t end);
+        void RemoveConsumer(size_t consumer);
+        void ResetConsumer(size_t consumer); //Skips everything published so far
+        uint64_t Unread(size_t consumer, uint64_t* begin) const;
+
+        size_t Capacity() const { return _capacity; }
+        uint64_t Head() const { return _head.load(std::memory_order_acquire); }
+        size_t MaxBatch() const { return _capacity/2; }
+        size_t NumChannels() const { return _numChannels; }
+        inline double Sample(size_t channel, uint64_t seq) const
+        {
+            return _data[channel*_capacity + (seq & _mask)];
+        }
+
+    private:
+        static size_t RoundUpPow2(size_t n);
+
+        uint64_t Oldest(uint64_t head) const;
+            //Oldest sample that can't be overwritten by the batch after head
+
+        const size_t _capacity, _mask;
+        std::atomic<uint64_t> _cursors[MAX_CONSUMERS];
+        std::vector<double> _data;
+        std::atomic<uint64_t> _head;
+        std::atomic<bool> _inUse[MAX_CONSUMERS];
+        const size_t _numChannels;
+        uint64_t _writeHead; //Only touched by the producer
+};
+
+#endif // SAMPLERING_H
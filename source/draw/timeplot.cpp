@@ -1,6 +1,6 @@
 #include "timeplot.h"
 
-TimePlot::TimePlot(DSPlot* plot) : DrawBase(plot), _lastPt(0)
+TimePlot::TimePlot(DSPlot* plot) : DrawBase(plot), _lastPt(0), _ringConsumer(0)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("TimePlot::TimePlot", std::this_thread::get_id());
@@ -9,7 +9,7 @@ TimePlot::TimePlot(DSPlot* plot) : DrawBase(plot), _lastPt(0)
 
 TimePlot::~TimePlot()
 {
-    for (auto it : _packets) delete it;
+    if (_ring) _ring->RemoveConsumer(_ringConsumer);
 }
 
 void TimePlot::SetNonConstOpaqueSpec(const std::string &key, void *value)
@@ -17,12 +17,16 @@ void TimePlot::SetNonConstOpaqueSpec(const std::string &key, void *value)
     if (key=="dv_data")
     {
         std::lock_guard<std::mutex> lock( Mutex() );
-        std::deque<Packet*>* packets = static_cast< std::deque<Packet*>* >(value);
-        if (packets)
+        std::shared_ptr<SampleRing>* ring = static_cast< std::shared_ptr<SampleRing>* >(value);
+        if (ring)
         {
-            for (size_t i=0; i<packets->size(); ++i)
-                _packets.push_back( packets->at(i) );
-            delete packets;
+            if (*ring != _ring)
+            {
+                if (_ring) _ring->RemoveConsumer(_ringConsumer);
+                _ring = *ring;
+                if (_ring) _ringConsumer = _ring->AddConsumer();
+            }
+            delete ring;
         }
     }
     DrawBase::SetNonConstOpaqueSpec(key, value);
@@ -49,14 +53,8 @@ void TimePlot::Initialize()
         AddPlotItem(curv);
     }
 
-    while (!_packets.empty())
-    {
-        delete _packets.front();
-        _packets.pop_front();
-    }
-    _ip.clear();
-    _diffPts = DataVec(num_diffs);
-    _varPts = DataVec(num_vars);
+    if (_ring) _ring->ResetConsumer(_ringConsumer);
+    _history.Reset(num_all_tplots);
     _eventPointCt = _lastPt = 0;
 
     SetSpec("past_samps_ct", 0);
@@ -94,49 +92,43 @@ void TimePlot::MakePlotItems()
 //    QTime timer;
 //    timer.start();
 
-    //Get the available packets
+    //Get the new samples, read straight out of the phase plot's ring
+    const int num_diffs = (int)_modelMgr->Model(ds::DIFF)->NumPars(),
+            num_vars = (int)_modelMgr->Model(ds::VAR)->NumPars();
     std::unique_lock<std::mutex> lock( Mutex() );
-//    if (_packets.empty()) return;
-    while (!_packets.empty())
+    std::shared_ptr<SampleRing> ring = _ring;
+    lock.unlock();
+    if (ring && ring->NumChannels()==_history.NumCols())
     {
-        const Packet* packet = _packets.front();
-        const size_t num_diffs = packet->diffs.size(),
-                num_vars = packet->vars.size(),
-                num_samples = packet->num_samples;
-        for (size_t k=0; k<num_samples; ++k)
-        {
-            for (size_t i=0; i<num_diffs; ++i)
-                _diffPts[i].push_back( packet->diffs.at(i)[k]);
-            for (size_t i=0; i<num_vars; ++i)
-                _varPts[i].push_back( packet->vars.at(i)[k]);
-            _ip.push_back( packet->ip[k] );
-        }
-        _packets.pop_front();
+        uint64_t begin;
+        const uint64_t end = ring->Unread(_ringConsumer, &begin);
+        const size_t num_cols = _history.NumCols();
+        std::vector<double> rows((end-begin)*num_cols);
+        for (uint64_t seq=begin; seq<end; ++seq)
+            for (size_t i=0; i<num_cols; ++i)
+                rows[(seq-begin)*num_cols + i] = ring->Sample(i, seq);
+        const uint64_t intact = ring->Release(_ringConsumer, begin, end);
+            //Anything before intact was overwritten by the compute thread while we copied
+        for (uint64_t seq=intact; seq<end; ++seq)
+            _history.PushBack(&rows[(seq-begin)*num_cols]);
     }
-    lock.unlock();
 
     //Shrink the buffers if need be, and record overshoot
-    const int num_diffs = (int)_modelMgr->Model(ds::DIFF)->NumPars(),
-            num_vars = (int)_modelMgr->Model(ds::VAR)->NumPars();
     int past_samps_ct = Spec_toi("past_samps_ct");
     const int max_size = std::min(MAX_BUF_SIZE, Spec_toi("num_samples"));
-    const int overflow = (int)_diffPts.at(0).size() - max_size;
+    const int overflow = (int)_history.Size() - max_size;
     if (overflow>0)
     {
-        for (int i=0; i<num_diffs; ++i)
-            _diffPts[i].erase(_diffPts[i].begin(), _diffPts[i].begin()+overflow);
-        for (int i=0; i<num_vars; ++i)
-            _varPts[i].erase(_varPts[i].begin(), _varPts[i].begin()+overflow);
-        _ip.erase(_ip.begin(), _ip.begin()+overflow);
+        _history.PopFront(overflow);
         past_samps_ct += overflow;
         _lastPt -= overflow;
     }
     SetSpec("past_samps_ct", past_samps_ct);
 
     //Get all of the information from the parameter fields, introducing new variables as needed.
-    const int num_tp_points = (int)_ip.size();
+    const int num_tp_points = (int)_history.Size();
     if (num_tp_points==0) return;
-    const int dv_start = std::max(0, (int)_diffPts.at(0).size()-num_tp_points),
+    const int dv_start = std::max(0, (int)_history.Size()-num_tp_points),
             dv_end = dv_start + num_tp_points;
         //variables, differential equations, and initial conditions, all of which can invoke named
         //values
@@ -146,19 +138,14 @@ void TimePlot::MakePlotItems()
     const bool thresh_above = Spec_tob("thresh_above");
 
     TPVTableModel* tp_model = _modelMgr->TPVModel();
-    const int num_all_tplots = 1 + num_diffs + num_vars,
-            step = std::max(1, num_tp_points / SamplesShown()),
-            num_plotted_pts = num_tp_points/step + (int)(num_tp_points%step != 0) - 1;
-        // -1 for the offset step
-
-    //This code is necessary to avoid sampling artifacts
-    static int last_step = 1;
-    if (last_step!=step)
-        last_step = step;
-    const int dv_step_off = step - (dv_start % step);
+    const int num_all_tplots = std::min(1 + num_diffs + num_vars, (int)_history.NumCols()),
+            num_buckets = std::max(1, std::min(SamplesShown()/2, Plot()->width()));
+        //Each bucket contributes its minimum and maximum, so spikes survive however long the
+        //window is
     const double model_step = _modelMgr->ModelStep();
-//    std::cerr << step << ", " << num_plotted_pts << ", " << past_samps_ct << ", " << dv_start
-//              << ", " << dv_step_off << ", " << dv_end << std::endl;
+    double y_tp_min(std::numeric_limits<double>::max()),
+            y_tp_max(-std::numeric_limits<double>::max());
+    std::vector<size_t> rows;
     static double last_val = event_threshold;
     for (int i=0; i<num_all_tplots; ++i)
     {
@@ -166,10 +153,7 @@ void TimePlot::MakePlotItems()
         {
             for (int k=_lastPt; k<num_tp_points; ++k, ++_eventPointCt)
             {
-                double val;
-                if (i==0) val = _ip.at(k);
-                else if (i<=num_diffs) val = _diffPts.at(i-1).at(k);
-                else val = _varPts.at(i-num_diffs-1).at(k);
+                const double val = _history.At(i, k);
 
                 if ((!thresh_above && val>=event_threshold && last_val<event_threshold)
                         || (thresh_above && val<=event_threshold && last_val>=event_threshold))
@@ -189,44 +173,23 @@ void TimePlot::MakePlotItems()
         const double scale = std::pow(10.0, tp_model->LogScale(i));
             // ### Use MSL for fast multiplication!
 
-        if (i==0) //IP
-        {
-            QPolygonF points_tp(num_plotted_pts);
-            for (int k=dv_start+dv_step_off, ct=0; ct<num_plotted_pts; k+=step, ++ct)
-                points_tp[ct] = QPointF((past_samps_ct+k)*model_step+time_offset, _ip.at(k)*scale);
-            curv->setSamples(points_tp);
-        }
-        else if (i<=num_diffs) //A differential
-        {
-            const int didx = i-1;
-            QPolygonF points_tp(num_plotted_pts);
-            for (int k=dv_start+dv_step_off, ct=0; ct<num_plotted_pts; k+=step, ++ct)
-                points_tp[ct] = QPointF( (past_samps_ct+k)*model_step+time_offset, _diffPts.at(didx).at(k)*scale);
-            curv->setSamples(points_tp);
-        }
-        else //A variable
-        {
-            const int vidx = i-num_diffs-1;
-            QPolygonF points_tp(num_plotted_pts);
-            for (int k=dv_start+dv_step_off, ct=0; ct<num_plotted_pts; k+=step, ++ct)
-                points_tp[ct] = QPointF( (past_samps_ct+k)*model_step+time_offset, _varPts.at(vidx).at(k)*scale);
-            curv->setSamples(points_tp);
-        }
+        //Column i holds the inner product, a differential, or a variable
+        rows.clear();
+        const std::pair<double,double> lims = _history.Envelope(i, dv_start, dv_end, num_buckets, rows);
+        const size_t num_plotted_pts = rows.size();
+        QPolygonF points_tp(num_plotted_pts);
+        for (size_t k=0; k<num_plotted_pts; ++k)
+            points_tp[k] = QPointF( (past_samps_ct+(int)rows[k])*model_step+time_offset,
+                                    _history.At(i, rows[k])*scale );
+        curv->setSamples(points_tp);
+
+        //Axis limits, which come with the envelope; scale is always positive
+        if (lims.first*scale < y_tp_min) y_tp_min = lims.first*scale;
+        if (lims.second*scale > y_tp_max) y_tp_max = lims.second*scale;
     }
     _lastPt = num_tp_points;
     emit Flag_d( (double)_eventPointCt * model_step );
 
-    //Get axis limits
-    double y_tp_min(std::numeric_limits<double>::max()),
-            y_tp_max(-std::numeric_limits<double>::max());
-    for (int i=0; i<num_all_tplots; ++i)
-        if (tp_model->IsEnabled(i))
-        {
-            const QwtPlotCurve* curv = static_cast<QwtPlotCurve*>( PlotItem(i) );
-            if (curv->maxYValue() > y_tp_max) y_tp_max = curv->maxYValue();
-            if (curv->minYValue() < y_tp_min) y_tp_min = curv->minYValue();
-        }
-
     SetSpec("dv_start", dv_start);
     SetSpec("dv_end", dv_end);
     SetSpec("y_tp_min", y_tp_min);
@@ -26,9 +26,11 @@ class TimePlot : public DrawBase
         std::vector<QColor> _colors;
         int _eventPointCt;
         double _lastPt;
-        std::deque<double> _ip;
-        DataVec _diffPts, _varPts;
-        std::deque<Packet*> _packets;
+        SampleHistory _history;
+            //Column 0 is the inner product, followed by the differentials and the variables,
+            //the same layout as the phase plot's ring
+        std::shared_ptr<SampleRing> _ring; //Owned by the phase plot
+        size_t _ringConsumer;
 };
 
 #endif // TIMEPLOT_H
@@ -61,62 +61,28 @@ void UserNullcline::ComputeData()
 
             ParserMgr& parser_mgr = GetParserMgr(0);
             const ParamModelBase* const diff_model = _modelMgr->Model(ds::DIFF);
-            const int num_diffs = (int)diff_model->NumPars(),
-                    num_vars = (int)_modelMgr->Model(ds::VAR)->NumPars();
-            double* resets = new double[num_diffs],
-                    * dcurrent = new double[num_diffs],
-                    * vcurrent = new double[num_vars];
-            memcpy(resets, parser_mgr.ConstData(ds::INIT), sizeof(double)*num_diffs);
-            memcpy(dcurrent, parser_mgr.ConstData(ds::DIFF), sizeof(double)*num_diffs);
-            memcpy(vcurrent, parser_mgr.ConstData(ds::VAR), sizeof(double)*num_vars);
+            const int num_diffs = (int)diff_model->NumPars();
+
+            //Set up the model--all points start from the current state, with x varying and y
+            //reset (it shouldn't matter at all what y gets set to).  The non-user variables
+            //(input files and random numbers) are held at their current values.
             for (int i=0; i<XRES; ++i)
-            {
-                //Set up the model
-                const double xij = i*xinc + xmin;
-                for (int j=0; j<num_diffs; ++j)
-                    if (j==xidx)
-                        parser_mgr.SetData(ds::DIFF, j, xij);
-                    else if (j==yidx) //Shouldn't matter at all what this gets set to
-                        parser_mgr.SetData(ds::DIFF, j, resets[j]);
-                    else
-                        parser_mgr.SetData(ds::DIFF, j, dcurrent[j]);
-                for (int j=0; j<num_vars; ++j)
-                    if ( Input::Type(_modelMgr->Model(ds::VAR)->Value(j)) != Input::USER )
-                        parser_mgr.SetData(ds::VAR, j, vcurrent[j]);
-                    //This is for input files and random numbers
-
-                //Evaluate the model--the user variables (which may depend on state variables
-                //and possibly appear in the nullcline statements), and the nullclines
-                for (int j=0; j<num_vars; ++j)
-                    if (_modelMgr->IsFreeze(ds::VAR,j))
-                    {
-                        std::string temp_key = _modelMgr->Model(ds::VAR)->TempKey(j);
-                        parser_mgr.QuickEval(temp_key + " = 0.0");
-                    }
-                    else if ( Input::Type(_modelMgr->Model(ds::VAR)->Value(j)) == Input::USER )
-                    {
-                        std::string var = _modelMgr->Model(ds::VAR)->TempExpression(j);
-                        parser_mgr.QuickEval(var);
-                    }
-                parser_mgr.TempEval(ds::VAR);
-                for (int j=0; j<num_ncs; ++j)
-                {
-                    std::string nullcline = _modelMgr->Model(ds::NC)->Expression(j);
-                    parser_mgr.QuickEval(nullcline);
-                }
+                x[i] = i*xinc + xmin;
+            parser_mgr.BatchBegin(XRES);
+            parser_mgr.SetBatchData(ds::DIFF, xidx, x);
+            parser_mgr.SetBatchData(ds::DIFF, yidx, parser_mgr.ConstData(ds::INIT)[yidx]);
 
-                //Retrieve the results
-                x[i] = xij;               
-                const double* ncs = parser_mgr.ConstData(ds::NC);
-                for (int j=0; j<num_ncs; ++j)
-                {
-                    int yidx_j = (int)diff_model->ShortKeyIndex( DependentVar( (size_t)j ) );
-                    if (yidx_j != yidx) continue;
-                    y[j*XRES + i] = ncs[j];
-                }
+            //Evaluate the model--the user variables (which may depend on state variables
+            //and possibly appear in the nullcline statements), and the nullclines, at x
+            parser_mgr.ParserEvalBatchNoStep();
+
+            //Retrieve the results
+            for (int j=0; j<num_ncs; ++j)
+            {
+                int yidx_j = (int)diff_model->ShortKeyIndex( DependentVar( (size_t)j ) );
+                if (yidx_j != yidx) continue;
+                memcpy(y + j*XRES, parser_mgr.BatchData(ds::NC, j), sizeof(double)*XRES);
             }
-            delete[] resets;
-            delete[] dcurrent;
 
             if (has_jacobian)
             {
@@ -131,20 +97,25 @@ void UserNullcline::ComputeData()
                         record->equilibria.push_back( ds::Equilibrium(ix, iy) );
                 }
 
-                const double* jacob_vec = parser_mgr.ConstData(ds::JAC);
                 const size_t num_eqs = record->equilibria.size(),
                         num_jacs = _modelMgr->Model(ds::JAC)->NumPars();
+                std::vector<double> eqx(num_eqs), eqy(num_eqs);
                 for (size_t i=0; i<num_eqs; ++i)
                 {
-                    parser_mgr.SetData(ds::DIFF, xidx, record->equilibria.at(i).x);
-                    parser_mgr.SetData(ds::DIFF, yidx, record->equilibria.at(i).y);
-                    for (size_t j=0; j<num_jacs; ++j)
-                    {
-                        std::string jac_ij = _modelMgr->Model(ds::JAC)->Expression(j);
-                        parser_mgr.QuickEval(jac_ij);
-                    }
+                    eqx[i] = record->equilibria.at(i).x;
+                    eqy[i] = record->equilibria.at(i).y;
+                }
+                parser_mgr.BatchBegin(num_eqs);
+                parser_mgr.SetBatchData(ds::DIFF, xidx, eqx.data());
+                parser_mgr.SetBatchData(ds::DIFF, yidx, eqy.data());
+                parser_mgr.ParserEvalBatchNoStep();
 
-                    record->equilibria[i].eq_cat = EquilibriumCat(jacob_vec, num_diffs);
+                std::vector<double> jacob_vec(num_jacs);
+                for (size_t i=0; i<num_eqs; ++i)
+                {
+                    for (size_t j=0; j<num_jacs; ++j)
+                        jacob_vec[j] = parser_mgr.BatchData(ds::JAC, j)[i];
+                    record->equilibria[i].eq_cat = EquilibriumCat(jacob_vec.data(), num_diffs);
                 }
             }
 
@@ -71,25 +71,31 @@ void VariableView::ComputeData()
         try
         {
             std::lock_guard<std::mutex> lock( Mutex() );
+            const int num_pts = _numFuncs*NUM_INCREMENTS;
+            std::vector<double> xvals(num_pts), zvals(num_pts);
             for (int k=0; k<_numFuncs; ++k)
+                for (int i=0; i<NUM_INCREMENTS; ++i)
+                {
+                    xvals[k*NUM_INCREMENTS+i] = xmin+i*xinc;
+                    zvals[k*NUM_INCREMENTS+i] = zmin+k*zinc;
+                }
+
+            ParserMgr& parser_mgr = GetParserMgr(0);
+            for (int j=0; j<num_steps; ++j)
             {
-                const double zval = zmin+k*zinc;
+                parser_mgr.SetBatchData(xmi, xidx, xvals.data());
+                parser_mgr.SetBatchData(zmi, zidx, zvals.data());
+                parser_mgr.ParserEvalBatch();
+            }
+            const double* yvals = parser_mgr.BatchData(ds::VAR, yidx);
+            for (int k=0; k<_numFuncs; ++k)
                 for (int i=0; i<NUM_INCREMENTS; ++i)
                 {
-                    const double xval = xmin+i*xinc;
-                    ParserMgr& parser_mgr = GetParserMgr(k*_numFuncs+i);
-                    for (int j=0; j<num_steps; ++j)
-                    {
-                        parser_mgr.SetData(xmi, xidx, xval);
-                        parser_mgr.SetData(zmi, zidx, zval);
-                        parser_mgr.ParserEval(false);
-                    }
-                    const double yval = parser_mgr.ConstData(ds::VAR)[yidx];
+                    const double yval = yvals[k*NUM_INCREMENTS+i];
                     if (yval<ymin) ymin = yval;
                     if (yval>ymax) ymax = yval;
-                    points[k][i] = QPointF(xval, yval);
+                    points[k][i] = QPointF(xmin+i*xinc, yval);
                 }
-            }
         }
         catch (std::exception& e)
         {
@@ -118,7 +124,9 @@ void VariableView::Initialize()
 #endif
     FreezeNonUser();
     _numFuncs = Spec_toi("use_z")==0 ? 1 : NUM_ZFUNCS;
-    InitParserMgrs(NUM_INCREMENTS*_numFuncs);
+    InitParserMgrs(1);
+    GetParserMgr(0).BatchBegin(NUM_INCREMENTS*_numFuncs);
+        //Each point keeps its own state from one computation to the next
 
     ClearPlotItems();
     const double cinc = _numFuncs==1 ? 0 : 255.0 / (double)(_numFuncs-1);
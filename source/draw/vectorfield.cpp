@@ -1,6 +1,7 @@
 #include "vectorfield.h"
 
 const int VectorField::DEFAULT_TAIL_LEN = 1;
+const size_t VectorField::MIN_TAIL_CAPACITY = 64;
 
 VectorField::VectorField(DSPlot* plot) : DrawBase(plot)
 {
@@ -14,7 +15,6 @@ VectorField::~VectorField()
     ScopeTracker st("VectorField::~VectorField", std::this_thread::get_id());
 #endif
     if (Data()) delete[] static_cast<QPolygonF*>( Data() );
-    for (auto it : _packets) delete[] it;
 }
 
 void VectorField::ComputeData()
@@ -27,8 +27,6 @@ void VectorField::ComputeData()
         if (!NeedRecompute() && !NeedNewStep())
             goto label;{
 
-        InitParserMgrs();
-
         const int xidx = Spec_toi("xidx"),
                 yidx = Spec_toi("yidx"),
                 tail_len = Spec_toi("tail_length"),
@@ -39,6 +37,10 @@ void VectorField::ComputeData()
                 xmax = _modelMgr->Maximum(ds::INIT, xidx),
                 ymin = _modelMgr->Minimum(ds::INIT, yidx),
                 ymax = _modelMgr->Maximum(ds::INIT, yidx);
+        const double bounds[4] = {xmin, xmax, ymin, ymax};
+        const bool restart = !grow_tail || NeedRestart(bounds);
+        if (restart) InitParserMgrs();
+
         SetSpec("xmin", xmin);
         SetSpec("xmax", xmax);
         SetSpec("ymin", ymin);
@@ -56,49 +58,75 @@ void VectorField::ComputeData()
                 yminb = ymin - 10*yinc,
                 ymaxb = ymax + 10*yinc;
 
+        size_t num_steps = 0;
         try
         {
-            std::lock_guard<std::mutex> lock( Mutex() );
-            RecomputeIfNeeded();
-            QPolygonF* data = new QPolygonF[_resolution*_resolution];
             ParserMgr& parser_mgr = GetParserMgr(0);
-            const double* const dcurrent = parser_mgr.ConstData(ds::DIFF),
-                    * const vcurrent = parser_mgr.ConstData(ds::VAR);
-            const int num_diffs = (int)_modelMgr->Model(ds::DIFF)->NumPars(),
-                    num_vars = (int)_modelMgr->Model(ds::VAR)->NumPars();
-            for (size_t i=0; i<_resolution; ++i)
-                for (size_t j=0; j<_resolution; ++j)
+            const size_t num_pts = _resolution*_resolution;
+            if (restart)
+            {
                 {
-//                    const int idx = i*_resolution+j;
-//                    ParserMgr& parser_mgr = GetParserMgr(idx);
-                    const double x = i*xinc + xmin,
-                                y = j*yinc + ymin;
-                    for (int k=0; k<num_diffs; ++k)
-                        if (k==xidx)
-                            parser_mgr.SetData(ds::DIFF, k, x);
-                        else if (k==yidx)
-                            parser_mgr.SetData(ds::DIFF, k, y);
-                        else
-                            parser_mgr.SetData(ds::DIFF, k, dcurrent[k]);
-                    for (int k=0; k<num_vars; ++k)
-                        if ( Input::Type(_modelMgr->Model(ds::VAR)->Value(k)) != Input::USER )
-                            parser_mgr.SetData(ds::VAR, k, vcurrent[k]);
-                        //This is for input files and random numbers
-
-                    const double* diffs = parser_mgr.ConstData(ds::DIFF);
-                    QPolygonF& pts = data[i*_resolution+j];
-                    pts = QPolygonF(_tailLength+1);
-                    pts[0] = QPointF(x, y);
-                    for (int k=1; k<=_tailLength; ++k)
+                    std::lock_guard<std::mutex> lock( Mutex() );
+                    RecomputeIfNeeded();
+                }
+                std::vector<double> xs(num_pts), ys(num_pts);
+                for (size_t i=0; i<_resolution; ++i)
+                    for (size_t j=0; j<_resolution; ++j)
                     {
-                        parser_mgr.ParserEval(false);
-                        const double dx = std::min(xmaxb, std::max(xminb, diffs[xidx])),
-                                dy = std::min(ymaxb, std::max(yminb, diffs[yidx]));
-                        pts[k] = QPointF(dx, dy);
+                        const size_t idx = i*_resolution+j;
+                        xs[idx] = i*xinc + xmin;
+                        ys[idx] = j*yinc + ymin;
                     }
+
+                //Every point starts from the current state, with only x and y changed; the
+                //other state variables and the non-user variables (input files and random
+                //numbers) are held at their current values
+                parser_mgr.BatchBegin(num_pts);
+                parser_mgr.SetBatchData(ds::DIFF, xidx, xs.data());
+                parser_mgr.SetBatchData(ds::DIFF, yidx, ys.data());
+                std::copy(bounds, bounds+4, _bounds);
+
+                std::lock_guard<std::mutex> lock( Mutex() );
+                _tails.num_pts = num_pts;
+                _tails.length = 0;
+                _tails.capacity = 0;
+                ReserveTails(_tailLength+1);
+                for (size_t idx=0; idx<num_pts; ++idx)
+                {
+                    _tails.x[idx*_tails.capacity] = xs[idx];
+                    _tails.y[idx*_tails.capacity] = ys[idx];
                 }
+                _tails.length = 1;
+            }
 
-            _packets.push_back(data);
+            //Only the steps the tails don't have yet are computed.  They're written past
+            //_tails.length, which MakePlotItems doesn't read, so the mutex is only needed
+            //when the buffer grows and when the new length is published.
+            const size_t length = _tails.length;
+            num_steps = _tailLength+1 - length;
+            if (length+num_steps > _tails.capacity)
+            {
+                std::lock_guard<std::mutex> lock( Mutex() );
+                ReserveTails(length+num_steps);
+            }
+            const size_t capacity = _tails.capacity;
+            double* tx = _tails.x.data(),
+                    * ty = _tails.y.data();
+            const double* xnext = parser_mgr.BatchData(ds::DIFF, xidx),
+                    * ynext = parser_mgr.BatchData(ds::DIFF, yidx);
+            for (size_t k=length; k<length+num_steps; ++k)
+            {
+                parser_mgr.ParserEvalBatch();
+                for (size_t idx=0; idx<num_pts; ++idx)
+                {
+                    tx[idx*capacity + k] = std::min(xmaxb, std::max(xminb, xnext[idx]));
+                    ty[idx*capacity + k] = std::min(ymaxb, std::max(yminb, ynext[idx]));
+                }
+            }
+
+            std::lock_guard<std::mutex> lock( Mutex() );
+            _tails.length += num_steps;
+            _tails.is_new = true;
         }
         catch (std::exception& e)
         {
@@ -106,7 +134,7 @@ void VectorField::ComputeData()
             throw (e);
         }
 
-        emit ComputeComplete(_tailLength);
+        emit ComputeComplete(num_steps);
 
         if (grow_tail)
             _tailLength += steps_per_sec*tail_len;
@@ -134,48 +162,34 @@ void VectorField::MakePlotItems()
     ScopeTracker st("VectorField::MakePlotItems", std::this_thread::get_id());
 #endif
 
-    std::unique_lock<std::mutex> lock( Mutex() );
-    if (_packets.empty()) return;
-    while (_packets.size()>1)
+    const size_t num_items = NumPlotItems();
+    std::lock_guard<std::mutex> lock( Mutex() );
+    if (!_tails.is_new) return;
+    _tails.is_new = false;
+
+    const size_t capacity = _tails.capacity,
+            length = _tails.length;
+    if (num_items != 3*_tails.num_pts || length<2) return;
+    for (size_t idx=0; idx<_tails.num_pts; ++idx)
     {
-        delete[] _packets.front();
-        _packets.pop_front();
-    }
-    QPolygonF* data = _packets.front();
-    _packets.pop_front();
-    lock.unlock();
-
-    if (!IsSpec("xmin")) return;
-    const double xmin = Spec_tod("xmin"),
-            ymin = Spec_tod("ymin"),
-            xinc = Spec_tod("xinc"),
-            yinc = Spec_tod("yinc");
-
-    const size_t tail_length = data[0].size()-1;
-    for (size_t i=0; i<_resolution; ++i)
-        for (size_t j=0; j<_resolution; ++j)
-        {
-            const double x = i*xinc + xmin,
-                        y = j*yinc + ymin;
-            const size_t idx = i*_resolution+j;
-            QPolygonF pts = data[idx];
-
-            QwtPlotMarker* marker = static_cast<QwtPlotMarker*>( PlotItem(3*idx + 0) );
-            marker->setXValue(x);
-            marker->setYValue(y);
-            marker->setZ(-1);
-
-            QwtPlotCurve* curv = static_cast<QwtPlotCurve*>( PlotItem(3*idx + 1) );
-            curv->setSamples(pts);
-            curv->setZ(-0.5);
-
-            QwtPlotCurve* arrow = static_cast<QwtPlotCurve*>( PlotItem(3*idx + 2) );
-            const ArrowHead arrow_head(pts[tail_length], pts[tail_length-1]);
-            arrow->setSamples(arrow_head.Points());
-            arrow->setZ(0);
-        }
+        const double* x = &_tails.x[idx*capacity],
+                * y = &_tails.y[idx*capacity];
+
+        QwtPlotMarker* marker = static_cast<QwtPlotMarker*>( PlotItem(3*idx + 0) );
+        marker->setXValue(x[0]);
+        marker->setYValue(y[0]);
+        marker->setZ(-1);
 
-    delete[] data;
+        QwtPlotCurve* curv = static_cast<QwtPlotCurve*>( PlotItem(3*idx + 1) );
+        curv->setSamples(x, y, (int)length);
+        curv->setZ(-0.5);
+
+        QwtPlotCurve* arrow = static_cast<QwtPlotCurve*>( PlotItem(3*idx + 2) );
+        const ArrowHead arrow_head(QPointF(x[length-1], y[length-1]),
+                                   QPointF(x[length-2], y[length-2]));
+        arrow->setSamples(arrow_head.Points());
+        arrow->setZ(0);
+    }
 }
 
 void VectorField::InitParserMgrs()
@@ -187,6 +201,47 @@ void VectorField::InitParserMgrs()
 //    FreezeNonUser();
     DrawBase::InitParserMgrs(1);
 //    DrawBase::InitParserMgrs(_resolution*_resolution);
+    GetParserMgr(0).SetOutputs(VecStr()); //Only the differentials are drawn
+}
+
+bool VectorField::NeedRestart(const double* bounds) const
+{
+    //Tails are only valid as long as nothing they depend on has changed:  the expressions,
+    //the grid and the parameters.  The GUI posts parameter edits to the ParserMgr, which
+    //applies them before its next step, so they show up here as a mismatch with the batch.
+    if (_tails.length==0 || NeedRecompute()
+            || (size_t)Spec_toi("resolution")!=_resolution
+            || !std::equal(bounds, bounds+4, _bounds))
+        return true;
+
+    const ParserMgr& parser_mgr = GetParserMgr(0);
+    const double* pars = parser_mgr.ConstData(ds::INP);
+    const size_t num_pars = _modelMgr->Model(ds::INP)->NumPars();
+    for (size_t i=0; i<num_pars; ++i)
+        if (parser_mgr.BatchData(ds::INP, i)[0] != pars[i])
+            return true;
+    return false;
+}
+
+void VectorField::ReserveTails(size_t length)
+{
+    //Caller holds the mutex.  Capacity doubles, so growing is rare.
+    if (length <= _tails.capacity) return;
+    size_t capacity = std::max(_tails.capacity, MIN_TAIL_CAPACITY);
+    while (capacity<length) capacity *= 2;
+
+    const size_t num_pts = _tails.num_pts;
+    std::vector<double> x(num_pts*capacity), y(num_pts*capacity);
+    for (size_t idx=0; idx<num_pts; ++idx)
+    {
+        std::copy_n(_tails.x.cbegin() + idx*_tails.capacity, _tails.length,
+                    x.begin() + idx*capacity);
+        std::copy_n(_tails.y.cbegin() + idx*_tails.capacity, _tails.length,
+                    y.begin() + idx*capacity);
+    }
+    _tails.x.swap(x);
+    _tails.y.swap(y);
+    _tails.capacity = capacity;
 }
 
 void VectorField::ResetPlotItems()
@@ -216,10 +271,9 @@ void VectorField::ResetPlotItems()
         AddPlotItem(curv);
         AddPlotItem(arrow);
     }
-    while (!_packets.empty())
     {
-        delete[] _packets.front();
-        _packets.pop_front();
+        std::lock_guard<std::mutex> lock( Mutex() );
+        _tails = Tails();
     }
 
     DrawBase::Initialize();
@@ -19,13 +19,30 @@ class VectorField : public DrawBase
 
     private:
         static const int DEFAULT_TAIL_LEN;
+        static const size_t MIN_TAIL_CAPACITY;
+
+        //Tails are kept from step to step and only extended, the state of each grid point
+        //being the ParserMgr's batch data.  Points are only ever appended, so points below
+        //length can be read under the mutex while new ones are being written.
+        struct Tails
+        {
+            Tails() : capacity(0), is_new(false), length(0), num_pts(0) {}
+            size_t capacity; //Point k of tail idx is at idx*capacity + k
+            bool is_new; //Extended since the last MakePlotItems
+            size_t length; //Points per tail, counting the starting point
+            size_t num_pts;
+            std::vector<double> x, y;
+        };
 
         void InitParserMgrs();
+        bool NeedRestart(const double* bounds) const;
+        void ReserveTails(size_t length);
         void ResetPlotItems(); //Reset parser and plot items
 
+        double _bounds[4]; //xmin, xmax, ymin, ymax of the current tails
         size_t _resolution; //thread-local
         int _tailLength;
-        std::deque<QPolygonF*> _packets;
+        Tails _tails;
 };
 
 #endif // VECTORFIELD_H
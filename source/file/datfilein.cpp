@@ -0,0 +1,57 @@
+#include "datfilein.h"
+
+DatFileIn::DatFileIn(const std::string& name)
+    : _file(name), _nthSample(1), _numRecords(0), _recordsOffset(0), _versionNum(0)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("DatFileIn::DatFileIn", std::this_thread::get_id());
+#endif
+    size_t pos = 0;
+    _versionNum = _file.Read<int>(pos);
+    pos += sizeof(int);
+
+    const int num_fields = _file.Read<int>(pos);
+    pos += sizeof(int);
+    if (num_fields<=0)
+        throw std::runtime_error("DatFileIn::DatFileIn: Bad header in " + name);
+    for (int i=0; i<num_fields; ++i)
+    {
+        const int len = _file.Read<int>(pos);
+        pos += sizeof(int);
+        _fields.push_back( _file.ReadString(pos, len) );
+        pos += len;
+    }
+
+    _nthSample = _file.Read<int>(pos);
+    pos += sizeof(int);
+
+    const int num_records = _file.Read<int>(pos);
+    pos += sizeof(int);
+    _recordsOffset = pos;
+
+    //A recording that was never closed has no record count, so it comes from the file size
+    const size_t record_size = _fields.size()*sizeof(double),
+            max_records = (_file.Size() - _recordsOffset) / record_size;
+    _numRecords = num_records>0 ? (size_t)num_records : max_records;
+    if (_numRecords>max_records)
+        throw std::runtime_error("DatFileIn::DatFileIn: " + name + " is truncated");
+}
+
+MappedArray DatFileIn::Column(size_t field) const
+{
+    if (field>=_fields.size())
+        throw std::runtime_error("DatFileIn::Column: Bad field index");
+    return _file.Array(_recordsOffset + field*sizeof(double), _numRecords,
+                       _fields.size()*sizeof(double));
+}
+int DatFileIn::FieldIndex(const std::string& field) const
+{
+    auto it = std::find(_fields.cbegin(), _fields.cend(), field);
+    return it==_fields.cend() ? -1 : (int)(it - _fields.cbegin());
+}
+MappedArray DatFileIn::Record(size_t record) const
+{
+    if (record>=_numRecords)
+        throw std::runtime_error("DatFileIn::Record: Bad record index");
+    return _file.Array(_recordsOffset + record*_fields.size()*sizeof(double), _fields.size());
+}
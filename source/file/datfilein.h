@@ -0,0 +1,31 @@
+#ifndef DATFILEIN_H
+#define DATFILEIN_H
+
+#include "mappedfile.h"
+
+//Reads the DatFileOut format in place from a memory map, so opening a recording costs the
+//header and nothing else
+class DatFileIn
+{
+    public:
+        DatFileIn(const std::string& name);
+
+        MappedArray Column(size_t field) const; //One value per record
+        int FieldIndex(const std::string& field) const; //-1 if there isn't one
+        MappedArray Record(size_t record) const; //One value per field
+
+        const VecStr& Fields() const { return _fields; }
+        int NthSample() const { return _nthSample; }
+        size_t NumFields() const { return _fields.size(); }
+        size_t NumRecords() const { return _numRecords; }
+        int VersionNum() const { return _versionNum; }
+
+    private:
+        VecStr _fields;
+        MappedFile _file;
+        int _nthSample;
+        size_t _numRecords, _recordsOffset;
+        int _versionNum;
+};
+
+#endif // DATFILEIN_H
@@ -1,21 +1,36 @@
 #include "datfileout.h"
 
-const int DatFileOut::BUFFER_SIZE = 16 * 1024 * 1024;
+#ifndef Q_OS_WIN
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const size_t DatFileOut::ALIGNMENT = 4096;
+const size_t DatFileOut::BUFFER_SIZE = 32 * 1024 * 1024;
 
-DatFileOut::DatFileOut(const std::string& name)
-    : _bufCt(0), _buffer(new double[BUFFER_SIZE]), _name(name),
-      _numElts(0), _out(nullptr)
+DatFileOut::DatFileOut(const std::string& name, bool direct)
+    : _direct(direct), _fd(-1), _fillCt(0), _fillIdx(0), _flushCt(0), _flushPending(false),
+      _name(name), _numElts(0), _numFields(0), _out(nullptr), _recordsPos(0), _stop(false),
+      _totalBytes(0)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("DatFileOut::DatFileOut", std::this_thread::get_id());
 #endif
+    _buffers[0] = _buffers[1] = nullptr;
 }
 DatFileOut::~DatFileOut()
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("DatFileOut::~DatFileOut", std::this_thread::get_id());
 #endif
-    delete[] _buffer;
+    try
+    {
+        if (_flusher.joinable()) Close();
+    }
+    catch (std::exception& e)
+    {
+        Log::Instance()->AddExcept("DatFileOut::~DatFileOut: " + std::string(e.what()));
+    }
 }
 
 void DatFileOut::Close()
@@ -23,12 +38,51 @@ void DatFileOut::Close()
 #ifdef DEBUG_FUNC
     ScopeTracker st("DatFileOut::Close", std::this_thread::get_id());
 #endif
-    fwrite(_buffer, sizeof(double), _bufCt, _out);
-    _numElts += _bufCt;
-    const int num_records = _numElts/_numFields;
-    fseek(_out, _recordsPos, SEEK_SET);
-    fwrite(&num_records, sizeof(int), 1, _out);
-    fclose(_out);
+    if (!_flusher.joinable()) return; //Never opened, or already closed
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [&]() { return !_flushPending; });
+        _stop = true;
+    }
+    _cv.notify_all();
+    _flusher.join();
+
+    try
+    {
+        if (_except) std::rethrow_exception(_except);
+        WriteOut(_buffers[_fillIdx], _fillCt, true);
+        _fillCt = 0;
+
+        const int num_records = (int)(_numElts/_numFields);
+#ifdef O_DIRECT
+        if (_fd!=-1)
+        {
+            //The padding of the last block is cut off, and the record count can't be
+            //written unaligned while O_DIRECT is set
+            fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_DIRECT);
+            if ( ftruncate(_fd, _totalBytes)!=0
+                 || pwrite(_fd, &num_records, sizeof(int), _recordsPos)!=(ssize_t)sizeof(int) )
+                throw std::runtime_error("DatFileOut::Close: Write failed");
+            close(_fd);
+            _fd = -1;
+            return;
+        }
+#endif
+        fseek(_out, _recordsPos, SEEK_SET);
+        fwrite(&num_records, sizeof(int), 1, _out);
+        fclose(_out);
+        _out = nullptr;
+    }
+    catch (std::exception&)
+    {
+#ifndef Q_OS_WIN
+        if (_fd!=-1) close(_fd);
+        _fd = -1;
+#endif
+        if (_out) fclose(_out);
+        _out = nullptr;
+        throw;
+    }
 }
 
 void DatFileOut::Open(const VecStr& fields, int nth_sample)
@@ -36,42 +90,141 @@ void DatFileOut::Open(const VecStr& fields, int nth_sample)
 #ifdef DEBUG_FUNC
     ScopeTracker st("DatFileOut::Open", std::this_thread::get_id());
 #endif
-    _out = fopen( (_name).c_str() , "wb");
-    if (!_out)
-        throw std::runtime_error("DatFileOut::Open: Bad File.");
+#ifdef O_DIRECT
+    if (_direct)
+        _fd = open(_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        //Not every file system supports O_DIRECT, in which case stdio is used after all
+#endif
+    if (_fd==-1)
+    {
+        _out = fopen( (_name).c_str() , "wb");
+        if (!_out)
+            throw std::runtime_error("DatFileOut::Open: Bad File.");
+    }
 
+    for (int i=0; i<2; ++i)
+    {
+        _raw[i].reset( new char[BUFFER_SIZE + ALIGNMENT] );
+        const size_t offset = (size_t)_raw[i].get() % ALIGNMENT;
+        _buffers[i] = _raw[i].get() + (offset ? ALIGNMENT-offset : 0);
+    }
+
+    //The header goes through the buffers too, so that every block is written aligned
     const int vnum = ds::VersionNum();
-    fwrite(&vnum, sizeof(int), 1, _out);
+    Append(&vnum, sizeof(int));
 
     _numFields = (int)fields.size();
-    fwrite(&_numFields, sizeof(int), 1, _out);
+    Append(&_numFields, sizeof(int));
 
     for (const auto& it : fields)
     {
         const int len = (int)it.length();
-        fwrite(&len, sizeof(int), 1, _out);
-        fputs(it.c_str(), _out);
+        Append(&len, sizeof(int));
+        Append(it.c_str(), len);
     }
 
-    fwrite(&nth_sample, sizeof(int), 1, _out);
+    Append(&nth_sample, sizeof(int));
 
-    _recordsPos = ftell(_out);
+    _recordsPos = (long)_fillCt;
     const int num_records = 0;
-    fwrite(&num_records, sizeof(int), 1, _out);
+    Append(&num_records, sizeof(int));
+
+    _flusher = std::thread(&DatFileOut::FlushLoop, this);
 }
 void DatFileOut::Write(const double* data, int N)
 {
-    if (_bufCt+N > BUFFER_SIZE)
+    Append(data, N*sizeof(double));
+    _numElts += N;
+}
+
+void DatFileOut::Append(const void* data, size_t len)
+{
+    const char* src = static_cast<const char*>(data);
+    while (len>0)
+    {
+        const size_t n = std::min(len, BUFFER_SIZE - _fillCt);
+        memcpy(_buffers[_fillIdx] + _fillCt, src, n);
+        _fillCt += n;
+        src += n;
+        len -= n;
+        if (_fillCt==BUFFER_SIZE) Submit();
+    }
+}
+void DatFileOut::FlushLoop()
+{
+    ds::AddThread(std::this_thread::get_id());
+#ifdef DEBUG_FUNC
+    ScopeTracker::InitThread(std::this_thread::get_id());
+    ScopeTracker st("DatFileOut::FlushLoop", std::this_thread::get_id());
+#endif
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _cv.wait(lock, [&]() { return _flushPending || _stop; });
+        if (!_flushPending) return;
+
+        char* buf = _buffers[1-_fillIdx];
+        const size_t len = _flushCt;
+        lock.unlock();
+        std::exception_ptr except;
+        try
+        {
+            WriteOut(buf, len, false);
+        }
+        catch (std::exception&)
+        {
+            except = std::current_exception();
+        }
+        lock.lock();
+
+        _flushPending = false;
+        _cv.notify_all();
+        if (except)
+        {
+            _except = except;
+            return;
+        }
+    }
+}
+void DatFileOut::Submit()
+{
     {
-        const int rem = BUFFER_SIZE - _bufCt;
-        memcpy(_buffer+_bufCt, data, rem*sizeof(double));
-        fwrite(_buffer, sizeof(double), BUFFER_SIZE, _out);
-        _bufCt = 0;
-        _numElts += BUFFER_SIZE;
+        std::unique_lock<std::mutex> lock(_mutex);
+        _cv.wait(lock, [&]() { return !_flushPending; });
+        if (_except) std::rethrow_exception(_except);
+        _flushCt = _fillCt;
+        _fillIdx = 1 - _fillIdx;
+        _fillCt = 0;
+        _flushPending = true;
     }
-    else
+    _cv.notify_all();
+}
+void DatFileOut::WriteOut(char* buf, size_t len, bool is_last)
+{
+#ifdef O_DIRECT
+    if (_fd!=-1)
     {
-        memcpy(_buffer+_bufCt, data, N*sizeof(double));
-        _bufCt += N;
+        //Full buffers are already a multiple of ALIGNMENT, the last one is zero padded
+        size_t padded = len;
+        if (is_last && len%ALIGNMENT)
+        {
+            padded += ALIGNMENT - len%ALIGNMENT;
+            memset(buf+len, 0, padded-len);
+        }
+        for (size_t done=0; done<padded; )
+        {
+            const ssize_t n = write(_fd, buf+done, padded-done);
+            if (n<=0)
+                throw std::runtime_error("DatFileOut::WriteOut: Write failed");
+            done += (size_t)n;
+        }
+        _totalBytes += len;
+        return;
     }
+#else
+    (void)is_last;
+#endif
+    if (fwrite(buf, 1, len, _out)!=len)
+        throw std::runtime_error("DatFileOut::WriteOut: Write failed");
+    _totalBytes += len;
 }
@@ -1,14 +1,23 @@
 #ifndef DATFILEOUT_H
 #define DATFILEOUT_H
 
+#include <condition_variable>
 #include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "../globals/scopetracker.h"
 
+//Double buffered:  Write fills one buffer while a flush thread writes the other out, so the
+//caller only waits if it gets a whole buffer ahead of the disk.  With direct set, and where the
+//platform has O_DIRECT, the file bypasses the page cache, which is worth it for recordings too
+//large to ever be read back from the cache.
 class DatFileOut
 {
     public:
-        DatFileOut(const std::string& name);
+        DatFileOut(const std::string& name, bool direct = false);
         ~DatFileOut();
 
         void Close();
@@ -16,14 +25,35 @@ class DatFileOut
         void Write(const double* data, int N);
 
     private:
-        static const int BUFFER_SIZE;
+        static const size_t ALIGNMENT, BUFFER_SIZE; //Bytes
 
-        int _bufCt;
-        double* const _buffer;
+#ifdef __GNUG__
+        DatFileOut(const DatFileOut&) = delete;
+        DatFileOut& operator=(const DatFileOut&) = delete;
+#endif
+
+        void Append(const void* data, size_t len); //Hands off each buffer as it fills
+        void FlushLoop();
+        void Submit(); //Waits for the previous flush, then starts one of the fill buffer
+        void WriteOut(char* buf, size_t len, bool is_last);
+
+        char* _buffers[2]; //Aligned, within _raw, which is allocated by Open
+        bool _direct;
+        std::exception_ptr _except;
+        std::condition_variable _cv;
+        int _fd; //Only for direct output
+        size_t _fillCt, _fillIdx, _flushCt;
+        bool _flushPending;
+        std::thread _flusher;
+        std::mutex _mutex;
         const std::string _name;
-        int _numElts, _numFields;
+        long long _numElts;
+        int _numFields;
         mutable FILE* _out;
+        std::unique_ptr<char[]> _raw[2];
         long _recordsPos;
+        bool _stop;
+        long long _totalBytes; //Written to the file so far
 };
 
 #endif // DATFILEOUT_H
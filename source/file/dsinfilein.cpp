@@ -0,0 +1,15 @@
+#include "dsinfilein.h"
+
+DsinFileIn::DsinFileIn(const std::string& name)
+    : _file(name), _samplesPerUnitTime(1), _versionNum(0)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("DsinFileIn::DsinFileIn", std::this_thread::get_id());
+#endif
+    _versionNum = _file.Read<int>(0);
+    _samplesPerUnitTime = _file.Read<int>(sizeof(int));
+    const int num_elts = _file.Read<int>(2*sizeof(int));
+    if (num_elts<=0 || _samplesPerUnitTime<=0)
+        throw std::runtime_error("DsinFileIn::DsinFileIn: Bad header in " + name);
+    _samples = _file.Array(3*sizeof(int), (size_t)num_elts);
+}
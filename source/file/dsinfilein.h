@@ -0,0 +1,23 @@
+#ifndef DSINFILEIN_H
+#define DSINFILEIN_H
+
+#include "mappedfile.h"
+
+//Reads a .dsin input file in place from a memory map:  the version number, the samples per
+//unit time, the number of samples, then the samples themselves
+class DsinFileIn
+{
+    public:
+        DsinFileIn(const std::string& name);
+
+        const MappedArray& Samples() const { return _samples; }
+        int SamplesPerUnitTime() const { return _samplesPerUnitTime; }
+        int VersionNum() const { return _versionNum; }
+
+    private:
+        MappedFile _file;
+        MappedArray _samples;
+        int _samplesPerUnitTime, _versionNum;
+};
+
+#endif // DSINFILEIN_H
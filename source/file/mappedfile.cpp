@@ -0,0 +1,42 @@
+#include "mappedfile.h"
+
+MappedFile::MappedFile(const std::string& name)
+    : _data(nullptr), _file(name.c_str()), _name(name), _size(0)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MappedFile::MappedFile", std::this_thread::get_id());
+#endif
+    if (!_file.open(QFile::ReadOnly))
+        throw std::runtime_error("MappedFile::MappedFile: File " + name + " failed to open.");
+    _size = (size_t)_file.size();
+    if (_size==0)
+        throw std::runtime_error("MappedFile::MappedFile: File " + name + " is empty.");
+    _data = _file.map(0, _file.size());
+    if (!_data)
+        throw std::runtime_error("MappedFile::MappedFile: File " + name + " failed to map.");
+}
+MappedFile::~MappedFile()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MappedFile::~MappedFile", std::this_thread::get_id());
+#endif
+    _file.unmap(const_cast<uchar*>(_data));
+    _file.close();
+}
+
+MappedArray MappedFile::Array(size_t offset, size_t length, size_t stride) const
+{
+    if (length>0) CheckRange(offset, (length-1)*stride + sizeof(double));
+    return MappedArray(_data + offset, length, stride);
+}
+std::string MappedFile::ReadString(size_t offset, size_t len) const
+{
+    CheckRange(offset, len);
+    return std::string((const char*)_data + offset, len);
+}
+
+void MappedFile::CheckRange(size_t offset, size_t len) const
+{
+    if (offset>_size || len>_size-offset)
+        throw std::runtime_error("MappedFile::CheckRange: Read past the end of " + _name);
+}
@@ -0,0 +1,70 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstring>
+
+#include <QFile>
+
+#include "../globals/globals.h"
+#include "../globals/scopetracker.h"
+
+//A run of doubles inside a mapping, every stride bytes, e.g. one column of a record file.
+//Values are read with memcpy since nothing in the DynaSys formats is aligned beyond 4 bytes.
+class MappedArray
+{
+    public:
+        MappedArray() : _base(nullptr), _length(0), _stride(sizeof(double)) {}
+        MappedArray(const uchar* base, size_t length, size_t stride = sizeof(double))
+            : _base(base), _length(length), _stride(stride) {}
+
+        inline double operator[](size_t i) const
+        {
+            double val;
+            memcpy(&val, _base + i*_stride, sizeof(double));
+            return val;
+        }
+
+        inline size_t Length() const { return _length; }
+
+    private:
+        const uchar* _base;
+        size_t _length, _stride;
+};
+
+//Read-only memory map of a whole file, which stays valid for the life of the object
+class MappedFile
+{
+    public:
+        MappedFile(const std::string& name);
+        ~MappedFile();
+
+        template<typename T>
+        T Read(size_t offset) const
+        {
+            CheckRange(offset, sizeof(T));
+            T val;
+            memcpy(&val, _data + offset, sizeof(T));
+            return val;
+        }
+        std::string ReadString(size_t offset, size_t len) const;
+        MappedArray Array(size_t offset, size_t length, size_t stride = sizeof(double)) const;
+            //Throws if the array runs past the end of the file
+
+        const std::string& Name() const { return _name; }
+        size_t Size() const { return _size; }
+
+    private:
+#ifdef __GNUG__
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+#endif
+
+        void CheckRange(size_t offset, size_t len) const;
+
+        const uchar* _data;
+        QFile _file;
+        const std::string _name;
+        size_t _size;
+};
+
+#endif // MAPPEDFILE_H
@@ -1,30 +1,47 @@
 #include "sharedobj.h"
 
 SharedObj::SharedObj(const std::string& name)
-    : CompilableBase(name, new CFileSO(name)), _nameO(NameRaw() + ".o")
+    : CompilableBase(name, new CFileSO(name)), _nameO(Path() + NameRaw() + ".o"),
+      _nameSO(Path() + "lib" + NameRaw() + ".so")
+{
+}
+SharedObj::SharedObj(const std::string& name, CFileBase* cfile)
+    : CompilableBase(name, cfile), _nameO(Path() + NameRaw() + ".o"),
+      _nameSO(Path() + "lib" + NameRaw() + ".so")
 {
 }
 
 void SharedObj::Compile()
 {
 #ifdef DEBUG_FUNC
-    ScopeTracker st("Compilable::Compile", std::this_thread::get_id());
+    ScopeTracker st("SharedObj::Compile", std::this_thread::get_id());
 #endif
-    GetCFile()->Make();
-
-    const std::string so_name = "lib" + NameRaw() + ".so";
-    const std::string cmd1 = "gcc -O3 -std=c11 -c -fPIC " + Name() + " -lm -o " + _nameO,
+    MakeCFile();
+    CompileCFile();
+}
+bool SharedObj::CompileCFile()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("SharedObj::CompileCFile", std::this_thread::get_id());
+#endif
+    const std::string so_name = ds::StripPath(_nameSO);
+    const std::string cmd1 = "gcc -O3 -std=c11 -c -fPIC " + GetCFile()->Name() + " -lm -o " + _nameO,
             cmd2 = "gcc -O3 -std=c11 -shared -Wl,-soname," + so_name + " -o "
-                    + so_name + " " + _nameO;
+                    + _nameSO + " " + _nameO;
 
-    _log->AddMesg("Compiling " + ds::StripPath(NameExe()) + " with " + cmd1 + ", " + cmd2);
+    _log->AddMesg("Compiling " + so_name + " with " + cmd1 + ", " + cmd2);
     auto comp_start = std::chrono::system_clock::now();
 
     int code1 = system(cmd1.c_str());
-    int code2 = system(cmd2.c_str());
+    int code2 = (code1==0) ? system(cmd2.c_str()) : -1;
 
     auto dur = std::chrono::system_clock::now() - comp_start;
     int dur_ms = std::chrono::duration_cast<std::chrono::milliseconds>(dur).count();
     _log->AddMesg(so_name + " compilation ended with codes " + std::to_string(code1)
             + ", " + std::to_string(code2) + " with a duration of " + std::to_string(dur_ms) + "ms.");
+    return code1==0 && code2==0;
+}
+void SharedObj::MakeCFile()
+{
+    GetCFile()->Make();
 }
@@ -8,11 +8,18 @@ class SharedObj : public CompilableBase
 {
     public:
         SharedObj(const std::string& name);
+        SharedObj(const std::string& name, CFileBase* cfile);
+            //Takes ownership of cfile
 
         virtual void Compile() override;
+        bool CompileCFile(); //Compiles the C file as already made by MakeCFile; false on failure
+        void MakeCFile();
+
+        const std::string& NameO() const { return _nameO; }
+        const std::string& NameSO() const { return _nameSO; }
 
     private:
-        const std::string _nameO;
+        const std::string _nameO, _nameSO;
 };
 
 #endif // SHAREDOBJ_H
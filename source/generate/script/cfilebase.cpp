@@ -1,8 +1,10 @@
 #include "cfilebase.h"
 
+const int CFileBase::RAND_BLOCK = 256;
+
 CFileBase::CFileBase(const std::string& name, const std::string& ext)
     : _log(Log::Instance()), _modelMgr(ModelMgr::Instance()), 
-      _nameBase(MakeName(name)), _nameExtension(ext)
+      _schedule(_modelMgr), _nameBase(MakeName(name)), _nameExtension(ext)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("CFileBase::CFileBase", std::this_thread::get_id());
@@ -19,6 +21,8 @@ void CFileBase::Make()
 
     WriteIncludes(out);
     WriteGlobalConst(out);
+    if (HasRandInput())
+        WriteRandFuncs(out);
     WriteVarDecls(out);
     WriteFuncs(out, ds::VAR);
     WriteFuncs(out, ds::DIFF);
@@ -34,6 +38,8 @@ void CFileBase::Make()
     //Load all input files
     if (static_cast<const VariableModel*>(_modelMgr->Model(ds::VAR))->TypeCount(Input::INPUT_FILE)>0)
         WriteLoadInput(out);
+    if (HasRandInput())
+        WriteRandInput(out);
 
     //Write header information to output destination
     WriteOutputHeader(out);
@@ -144,6 +150,20 @@ std::string CFileBase::PreprocessExprn(const std::string& exprn) const
     }
     return temp;
 }
+std::string CFileBase::ScheduledVars(const std::string& line_end) const
+{
+    const ParamModelBase* variables = _modelMgr->Model(ds::VAR);
+    std::string out;
+    for (const auto& group : _schedule.VarGroups())
+    {
+        for (auto i : group)
+            out += "        " + variables->ShortKey(i) + "_func(" + FuncArgs(ds::VAR, i) + ")"
+                    + line_end;
+        for (auto i : group)
+            out += "        " + variables->ShortKey(i) + " = " + variables->TempKey(i) + line_end;
+    }
+    return out;
+}
 
 void CFileBase::WriteConditions(std::ofstream& out)
 {
@@ -173,27 +193,56 @@ void CFileBase::WriteExecVarsDiffs(std::ofstream& out)
             * diffs = _modelMgr->Model(ds::DIFF);
     const size_t num_vars = variables->NumPars(),
             num_diffs = diffs->NumPars();
+    const bool uses_solver = UsesSolver();
     for (size_t i=0; i<num_vars; ++i)
     {
         if (variables->IsFreeze(i)) continue;
         std::string value = variables->Value(i);
-        if (Input::Type(value)==Input::USER)
-            out << "        " + variables->ShortKey(i) + "_func(" + FuncArgs(ds::VAR, i) + ");\n";
-        else
+        if (Input::Type(value)!=Input::USER)
         {
             std::string var = variables->ShortKey(i),
                     inputv = "input_" + var,
                     sputv = "sput_" + var, //samples per unit time
                     samps_ct = "ct_" + var;
-            out <<
-                   "        if (i % " + sputv + " == 0)\n"
-                   "            " + var + " = " + inputv + "[" + samps_ct + "++];\n"
-                   "        \n";
+            if (Input::IsRandom(Input::Type(value)))
+                out <<
+                       "        if (i % " + sputv + " == 0)\n"
+                       "        {\n"
+                       "            if (" + samps_ct + " == DS_RAND_BLOCK)\n"
+                       "            {\n"
+                       "                ds_rand_fill(" + RandArgs(i) + ", ++blk_" + var
+                                + "*DS_RAND_BLOCK, " + inputv + ");\n"
+                       "                " + samps_ct + " = 0;\n"
+                       "            }\n"
+                       "            " + var + " = " + inputv + "[" + samps_ct + "++];\n"
+                       "        }\n"
+                       "        \n";
+            else
+                out <<
+                       "        if (i % " + sputv + " == 0)\n"
+                       "            " + var + " = " + inputv + "[" + samps_ct + "++];\n"
+                       "        \n";
         }
     }
-    for (size_t i=0; i<num_vars; ++i)
-        if (Input::Type(variables->Value(i))==Input::USER && !variables->IsFreeze(i))
-            out << "        " + variables->ShortKey(i) + " = " + variables->TempKey(i) + ";\n";
+    if (uses_solver)
+    {
+        switch (_modelMgr->DiffMethod())
+        {
+            case ModelMgr::DORMAND_PRINCE:
+                WriteDormandPrince(out);
+                break;
+            case ModelMgr::ROSENBROCK:
+                WriteRosenbrock(out);
+                break;
+            default:
+                WriteRungeKutta(out);
+                break;
+        }
+        out << "//End CFileBase::WriteExecVarsDiffs\n";
+        out << "\n";
+        return;
+    }
+    out << ScheduledVars(";\n");
     out << "\n";
     for (size_t i=0; i<num_diffs; ++i)
         if (!diffs->IsFreeze(i))
@@ -213,11 +262,12 @@ void CFileBase::WriteFuncs(std::ofstream& out, ds::PMODEL mi)
     for (size_t i=0; i<num_pars; ++i)
     {
         std::string value = model->Value(i);
-        if (Input::Type(value)==Input::INPUT_FILE) continue;
+        if (Input::Type(value)!=Input::USER) continue; //Input files and random inputs
         out <<
                "inline void " + model->ShortKey(i) + "_func()\n"
                "{\n"
-               "    " + PreprocessExprn( model->TempExprnForCFile(i) ) + ";\n"
+               "    " + PreprocessExprn( _schedule.Specialize(model->TempExprnForCFile(i), false) )
+                    + ";\n"
                "}\n";
     }
     out << "//End CFileBase::WriteFuncs\n";
@@ -228,7 +278,7 @@ void CFileBase::WriteGlobalConst(std::ofstream& out)
 {
     out << "//Begin CFileBase::WriteGlobalConst\n";
     out << "const int INPUT_SIZE = " << Input::INPUT_SIZE << ";\n";
-    out << "const double tau = " << _modelMgr->ModelStep() << ";\n";
+    out << "const double tau = " << _modelMgr->ModelStepStr() << ";\n";
     out << "//End CFileBase::WriteGlobalConst\n";
     out << "\n";
 }
@@ -253,6 +303,8 @@ void CFileBase::WriteInitVarsDiffs(std::ofstream& out)
     }
     for (size_t i=0; i<num_diffs; ++i)
         out << "    " + diffs->ShortKey(i) + " = " + diffs->ShortKey(i) + "0;\n";
+    if (UsesSolver())
+        WriteSolverInit(out);
     out << "//End CFileBase::WriteInitVarsDiffs\n";
     out << "\n";
 }
@@ -316,6 +368,94 @@ void CFileBase::WriteLoadInput(std::ofstream& out)
     out << "\n";
 }
 
+void CFileBase::WriteRandFuncs(std::ofstream& out)
+{
+    //Philox4x32-10, exactly as in the Philox class, so compiled runs draw the words DynaSys
+    //does.  Uniform samples are then exact on every target.  Normal and exponential samples go
+    //through log and cos, so they match bit for bit only on CPU targets using the same libm as
+    //DynaSys; CUDA's device log and cos can differ in the last bits.
+    out << "//Begin CFileBase::WriteRandFuncs\n";
+    out <<
+           "#ifdef __CUDACC__\n"
+           "#define DS_RAND_FUNC __device__ static inline\n"
+           "#else\n"
+           "#define DS_RAND_FUNC static inline\n"
+           "#endif\n"
+           "#ifndef DS_RAND_SEED\n" //So a build can be given another seed with -D
+           "#define DS_RAND_SEED " + std::to_string(InputMgr::Instance()->Seed()) + "u\n"
+           "#endif\n"
+           "#define DS_RAND_BLOCK " + std::to_string(RAND_BLOCK) + "\n"
+           "DS_RAND_FUNC void ds_philox(unsigned long long counter, unsigned int seed,\n"
+           "                            unsigned int stream, unsigned int* out)\n"
+           "{\n"
+           "    unsigned int c0 = (unsigned int)counter, c1 = (unsigned int)(counter >> 32),\n"
+           "            c2 = 0, c3 = 0, k0 = seed, k1 = stream;\n"
+           "    int r;\n"
+           "    for (r=0; r<10; ++r)\n"
+           "    {\n"
+           "        const unsigned long long p0 = 0xD2511F53ull * c0, p1 = 0xCD9E8D57ull * c2;\n"
+           "        const unsigned int n0 = (unsigned int)(p1 >> 32) ^ c1 ^ k0,\n"
+           "                n2 = (unsigned int)(p0 >> 32) ^ c3 ^ k1;\n"
+           "        c1 = (unsigned int)p1;\n"
+           "        c3 = (unsigned int)p0;\n"
+           "        c0 = n0;\n"
+           "        c2 = n2;\n"
+           "        k0 += 0x9E3779B9u;\n"
+           "        k1 += 0xBB67AE85u;\n"
+           "    }\n"
+           "    out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;\n"
+           "}\n"
+           "DS_RAND_FUNC double ds_rand_unit(unsigned int hi, unsigned int lo)\n"
+           "{\n"
+           "    return (double)( (((unsigned long long)hi << 32) | lo) >> 11 )\n"
+           "            * (1.0/9007199254740992.0);\n"
+           "}\n"
+           "DS_RAND_FUNC void ds_rand_fill(int dist, unsigned int seed, unsigned int stream,\n"
+           "                               unsigned long long first, double* dest)\n"
+           "{\n"
+           "    unsigned int w[4];\n"
+           "    int i;\n"
+           "    for (i=0; i<DS_RAND_BLOCK; ++i)\n"
+           "    {\n"
+           "        ds_philox(first+i, seed, stream, w);\n"
+           "        if (dist==" + std::to_string(RandSource::UNIFORM) + ")\n"
+           "            dest[i] = ds_rand_unit(w[0], w[1]);\n"
+           "        else if (dist==" + std::to_string(RandSource::NORMAL) + ")\n"
+           "            dest[i] = sqrt(-2.0*log(1.0 - ds_rand_unit(w[0], w[1])))\n"
+           "                    * cos(6.283185307179586*ds_rand_unit(w[2], w[3]));\n"
+           "        else\n"
+           "            dest[i] = -log(1.0 - ds_rand_unit(w[0], w[1]));\n"
+           "    }\n"
+           "}\n";
+    out << "//End CFileBase::WriteRandFuncs\n";
+    out << "\n";
+}
+void CFileBase::WriteRandInput(std::ofstream& out)
+{
+    out << "//Begin CFileBase::WriteRandInput\n";
+    const ParamModelBase* variables = _modelMgr->Model(ds::VAR);
+    const size_t num_vars = variables->NumPars();
+    for (size_t i=0, ct=0; i<num_vars; ++i)
+    {
+        if (variables->IsFreeze(i)) continue;
+        if (!Input::IsRandom(Input::Type(variables->Value(i)))) continue;
+
+        //Samples are drawn a block at a time, one unit of time apart
+        const std::string var = variables->Key(i),
+                inputv = "input_" + var,
+                sputv = "sput_" + var,
+                samps_ct = "ct_" + var;
+        if (ct++!=0) out << "\n";
+        out <<
+               "    double " + inputv + "[DS_RAND_BLOCK];\n"
+               "    unsigned long long blk_" + var + " = 0;\n"
+               "    int " + samps_ct + " = 0, " + sputv + " = (int)(1.0/tau + 0.5);\n"
+               "    ds_rand_fill(" + RandArgs(i) + ", 0, " + inputv + ");\n";
+    }
+    out << "//End CFileBase::WriteRandInput\n";
+    out << "\n";
+}
+
 void CFileBase::WriteSave(std::ofstream& out)
 {
     out <<
@@ -370,6 +510,15 @@ void CFileBase::WriteVarDecls(std::ofstream& out)
     out << "\n";
 }
 
+bool CFileBase::HasRandInput() const
+{
+    const ParamModelBase* variables = _modelMgr->Model(ds::VAR);
+    const size_t num_vars = variables->NumPars();
+    for (size_t i=0; i<num_vars; ++i)
+        if (!variables->IsFreeze(i) && Input::IsRandom(Input::Type(variables->Value(i))))
+            return true;
+    return false;
+}
 std::string CFileBase::MakeName(const std::string& name) const
 {
     std::string out(name);
@@ -378,3 +527,376 @@ std::string CFileBase::MakeName(const std::string& name) const
         out.erase(pos);
     return out;
 }
+std::string CFileBase::RandArgs(size_t var_idx) const
+{
+    const Input::TYPE type = Input::Type( _modelMgr->Model(ds::VAR)->Value(var_idx) );
+    return std::to_string(Input::RandDist(type)) + ", DS_RAND_SEED, " + std::to_string(var_idx);
+}
+RungeKutta::METHOD CFileBase::RkMethod() const
+{
+    return (_modelMgr->DiffMethod()==ModelMgr::EULER2) ? RungeKutta::HEUN : RungeKutta::CLASSIC;
+}
+bool CFileBase::UsesSolver() const
+{
+    if (!_modelMgr->HasSolver()) return false;
+    const ParamModelBase* diffs = _modelMgr->Model(ds::DIFF);
+    const size_t num_diffs = diffs->NumPars();
+    for (size_t i=0; i<num_diffs; ++i)
+        if (!diffs->IsFreeze(i)) return true;
+    return false;
+}
+std::string CFileBase::WeightedSum(const double* w, int num) const
+{
+    std::string sum;
+    for (int j=0; j<num; ++j)
+    {
+        if (w[j]==0) continue;
+        std::ostringstream term;
+        term.precision(17);
+        term << std::fabs(w[j]) << "*ds_k[" << j << "][ds_n]";
+        if (sum.empty())
+            sum = (w[j]<0 ? "-" : "") + term.str();
+        else
+            sum += (w[j]<0 ? " - " : " + ") + term.str();
+    }
+    return sum;
+}
+void CFileBase::WriteDormandPrince(std::ofstream& out)
+{
+    //Mirrors DormandPrince::Advance, with the coefficients written in and the stages unrolled
+    auto coef = [](double c)
+    {
+        std::ostringstream ss;
+        ss.precision(17);
+        ss << c;
+        return ss.str();
+    };
+
+    out <<
+           "        //Begin CFileBase::WriteDormandPrince\n"
+           "        DS_GET_STATE(ds_y);\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            if (ds_y[ds_n]!=ds_out[ds_n]) break;\n"
+           "        if (ds_n<DS_N) //Changed by a condition, so restart from the new state\n"
+           "        {\n"
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "                ds_x0[ds_n] = ds_x1[ds_n] = ds_y[ds_n];\n"
+           "            ds_t0 = ds_t1 = 0;\n"
+           "            DS_DERIV(ds_x1, ds_f1);\n"
+           "        }\n"
+           "        else if (DS_HOLD) //The inputs have moved on since ds_f1 was evaluated\n"
+           "            DS_DERIV(ds_x1, ds_f1);\n"
+           "        ds_end = 0;\n"
+           "        while (ds_t1 < tau)\n"
+           "        {\n"
+           "            double ds_step = ds_h, ds_err = 0, ds_fac;\n"
+           "            ds_end = 0;\n"
+           "            if (DS_HOLD && ds_t1 + ds_step >= tau)\n"
+           "            {\n"
+           "                ds_step = tau - ds_t1;\n"
+           "                ds_end = 1;\n"
+           "            }\n"
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "                ds_k[0][ds_n] = ds_f1[ds_n];\n";
+    for (int s=1; s<7; ++s)
+        out <<
+               "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+               "                ds_y[ds_n] = ds_x1[ds_n] + ds_step*("
+                    + WeightedSum(DormandPrince::A[s], s) + ");\n"
+               "            DS_DERIV(ds_y, ds_k[" + std::to_string(s) + "]);\n";
+    out <<
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            {\n"
+           "                const double e = ds_step*("
+                + WeightedSum(DormandPrince::E, 7) + "),\n"
+           "                        sc = ds_tol + ds_tol*fmax(fabs(ds_x1[ds_n]), fabs(ds_y[ds_n]));\n"
+           "                ds_err += (e/sc)*(e/sc);\n"
+           "            }\n"
+           "            ds_err = sqrt(ds_err/DS_N);\n"
+           "            ds_fac = (ds_err==0) ? " + coef(DormandPrince::MAX_FACTOR) + "\n"
+           "                    : fmin(" + coef(DormandPrince::MAX_FACTOR) + ", fmax("
+                + coef(DormandPrince::MIN_FACTOR) + ", "
+                + coef(DormandPrince::SAFETY) + "*pow(ds_err, -0.2)));\n"
+           "            if (ds_err<=1.0 || ds_step<=tau*DS_MIN_STEP)\n"
+           "            {\n"
+           "                //Rather than fail, a step of the minimum size is taken regardless\n"
+           "                for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "                {\n"
+           "                    ds_x0[ds_n] = ds_x1[ds_n];\n"
+           "                    ds_x1[ds_n] = ds_y[ds_n];\n"
+           "                    ds_f1[ds_n] = ds_k[6][ds_n];\n"
+           "                }\n"
+           "                ds_t0 = ds_t1;\n"
+           "                ds_t1 = ds_end ? tau : ds_t1 + ds_step;\n"
+           "                ds_hlast = ds_step;\n"
+           "                if (!ds_end || ds_fac<1.0) ds_h = ds_step*ds_fac;\n"
+           "            }\n"
+           "            else\n"
+           "            {\n"
+           "                ds_end = 0;\n"
+           "                ds_h = fmax(ds_step*fmin(ds_fac, 1.0), tau*DS_MIN_STEP);\n"
+           "            }\n"
+           "        }\n"
+           "        if (ds_t1==tau)\n"
+           "        {\n"
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "                ds_y[ds_n] = ds_x1[ds_n];\n"
+           "        }\n"
+           "        else\n"
+           "        {\n"
+           "            const double th = (tau - ds_t0)/ds_hlast, th1 = 1.0 - th;\n"
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            {\n"
+           "                const double dx = ds_x1[ds_n] - ds_x0[ds_n],\n"
+           "                        bspl = ds_hlast*ds_k[0][ds_n] - dx,\n"
+           "                        r4 = dx - ds_hlast*ds_k[6][ds_n] - bspl,\n"
+           "                        r5 = ds_hlast*("
+                + WeightedSum(DormandPrince::D, 7) + ");\n"
+           "                ds_y[ds_n] = ds_x0[ds_n] + th*(dx + th1*(bspl + th*(r4 + th1*r5)));\n"
+           "            }\n"
+           "            ds_end = 0;\n"
+           "        }\n"
+           "        ds_t0 -= tau;\n"
+           "        ds_t1 -= tau;\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            ds_out[ds_n] = ds_y[ds_n];\n"
+           "        if (!ds_end) DS_DERIV(ds_y, ds_f);\n"
+           "            //Sets the state, and brings the variables up to date with it\n"
+           "        //End CFileBase::WriteDormandPrince\n";
+}
+void CFileBase::WriteDormandPrinceInit(std::ofstream& out)
+{
+    out << "//Begin CFileBase::WriteDormandPrinceInit\n";
+    std::ostringstream tol;
+    tol.precision(17);
+    tol << _modelMgr->Tolerance();
+    out <<
+           "#define DS_MIN_STEP 1e-12\n"
+           "    const double ds_tol = " + tol.str() + ";\n"
+           "    double ds_x0[DS_N], ds_x1[DS_N], ds_f1[DS_N], ds_k[7][DS_N], ds_y[DS_N],\n"
+           "            ds_out[DS_N], ds_f[DS_N];\n"
+           "    double ds_t0 = 0, ds_t1 = 0, ds_h = tau, ds_hlast = tau;\n"
+           "        //The last accepted step runs from ds_t0 to ds_t1, relative to the last output\n"
+           "    int ds_end = 0, ds_n;\n"
+           "    DS_GET_STATE(ds_x1);\n"
+           "    for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "        ds_x0[ds_n] = ds_out[ds_n] = ds_x1[ds_n];\n"
+           "    DS_DERIV(ds_x1, ds_f1);\n";
+    out << "//End CFileBase::WriteDormandPrinceInit\n";
+}
+void CFileBase::WriteRosenbrock(std::ofstream& out)
+{
+    //Mirrors Rosenbrock::Advance
+    out <<
+           "        //Begin CFileBase::WriteRosenbrock\n"
+           "        DS_GET_STATE(ds_y);\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            if (ds_y[ds_n]!=ds_out[ds_n]) break;\n"
+           "        if (ds_n<DS_N) //Changed by a condition, so restart from the new state\n"
+           "        {\n"
+           "            DS_DERIV(ds_y, ds_f);\n"
+           "            ds_jac_ct = DS_JAC_REUSE;\n"
+           "        }\n"
+           "        else if (DS_HOLD) //The inputs have moved on since ds_f was evaluated\n"
+           "            DS_DERIV(ds_y, ds_f);\n"
+           "        if (ds_jac_ct>=DS_JAC_REUSE)\n"
+           "        {\n"
+           "#ifdef DS_JAC\n"
+           "            DS_JAC(ds_y, ds_lu);\n"
+           "#else\n"
+           "            for (ds_j=0; ds_j<DS_N; ++ds_j) //Forward differences, a column at a time\n"
+           "            {\n"
+           "                const double dx = sqrt(2.2e-16) * fmax(fabs(ds_y[ds_j]), 1.0);\n"
+           "                for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "                    ds_x[ds_n] = ds_y[ds_n];\n"
+           "                ds_x[ds_j] += dx;\n"
+           "                DS_DERIV(ds_x, ds_k2);\n"
+           "                for (ds_i=0; ds_i<DS_N; ++ds_i)\n"
+           "                    ds_lu[ds_i*DS_N + ds_j] = (ds_k2[ds_i] - ds_f[ds_i]) / dx;\n"
+           "            }\n"
+           "#endif\n"
+           "            for (ds_n=0; ds_n<DS_N*DS_N; ++ds_n)\n"
+           "                ds_lu[ds_n] *= -ds_gamma*tau;\n"
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "                ds_lu[ds_n*DS_N + ds_n] += 1.0;\n"
+           "            for (ds_n=0; ds_n<DS_N; ++ds_n) //LU, with partial pivoting\n"
+           "            {\n"
+           "                int p = ds_n;\n"
+           "                for (ds_i=ds_n+1; ds_i<DS_N; ++ds_i)\n"
+           "                    if (fabs(ds_lu[ds_i*DS_N + ds_n]) > fabs(ds_lu[p*DS_N + ds_n])) p = ds_i;\n"
+           "                ds_piv[ds_n] = p;\n"
+           "                if (p!=ds_n)\n"
+           "                    for (ds_j=0; ds_j<DS_N; ++ds_j)\n"
+           "                    {\n"
+           "                        const double t = ds_lu[ds_n*DS_N + ds_j];\n"
+           "                        ds_lu[ds_n*DS_N + ds_j] = ds_lu[p*DS_N + ds_j];\n"
+           "                        ds_lu[p*DS_N + ds_j] = t;\n"
+           "                    }\n"
+           "                for (ds_i=ds_n+1; ds_i<DS_N; ++ds_i)\n"
+           "                {\n"
+           "                    const double m = (ds_lu[ds_i*DS_N + ds_n] /= ds_lu[ds_n*DS_N + ds_n]);\n"
+           "                    for (ds_j=ds_n+1; ds_j<DS_N; ++ds_j)\n"
+           "                        ds_lu[ds_i*DS_N + ds_j] -= m*ds_lu[ds_n*DS_N + ds_j];\n"
+           "                }\n"
+           "            }\n"
+           "            ds_jac_ct = 0;\n"
+           "        }\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            ds_k1[ds_n] = ds_f[ds_n];\n"
+           "        DS_SOLVE(ds_k1);\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            ds_x[ds_n] = ds_y[ds_n] + tau*ds_k1[ds_n];\n"
+           "        DS_DERIV(ds_x, ds_k2);\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            ds_k2[ds_n] -= 2.0*ds_k1[ds_n];\n"
+           "        DS_SOLVE(ds_k2);\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            ds_out[ds_n] = ds_y[ds_n] += tau*(1.5*ds_k1[ds_n] + 0.5*ds_k2[ds_n]);\n"
+           "        DS_DERIV(ds_y, ds_f);\n"
+           "            //Sets the state, and brings the variables up to date with it\n"
+           "        ++ds_jac_ct;\n"
+           "        //End CFileBase::WriteRosenbrock\n";
+}
+void CFileBase::WriteRosenbrockInit(std::ofstream& out)
+{
+    out << "//Begin CFileBase::WriteRosenbrockInit\n";
+    std::ostringstream gamma;
+    gamma.precision(17);
+    gamma << Rosenbrock::GAMMA;
+    out <<
+           "#define DS_JAC_REUSE " + std::to_string(Rosenbrock::JAC_REUSE) + "\n"
+           "#define DS_SOLVE(ds_pb) do { \\\n"
+           "        for (ds_i=0; ds_i<DS_N; ++ds_i) \\\n"
+           "            if (ds_piv[ds_i]!=ds_i) \\\n"
+           "            { \\\n"
+           "                const double t = (ds_pb)[ds_i]; \\\n"
+           "                (ds_pb)[ds_i] = (ds_pb)[ds_piv[ds_i]]; \\\n"
+           "                (ds_pb)[ds_piv[ds_i]] = t; \\\n"
+           "            } \\\n"
+           "        for (ds_i=1; ds_i<DS_N; ++ds_i) \\\n"
+           "            for (ds_j=0; ds_j<ds_i; ++ds_j) \\\n"
+           "                (ds_pb)[ds_i] -= ds_lu[ds_i*DS_N + ds_j]*(ds_pb)[ds_j]; \\\n"
+           "        for (ds_i=DS_N-1; ds_i>=0; --ds_i) \\\n"
+           "        { \\\n"
+           "            for (ds_j=ds_i+1; ds_j<DS_N; ++ds_j) \\\n"
+           "                (ds_pb)[ds_i] -= ds_lu[ds_i*DS_N + ds_j]*(ds_pb)[ds_j]; \\\n"
+           "            (ds_pb)[ds_i] /= ds_lu[ds_i*DS_N + ds_i]; \\\n"
+           "        } \\\n"
+           "    } while (0)\n"
+           "    const double ds_gamma = " + gamma.str() + ";\n"
+           "    double ds_f[DS_N], ds_k1[DS_N], ds_k2[DS_N], ds_x[DS_N], ds_y[DS_N], ds_out[DS_N],\n"
+           "            ds_lu[DS_N*DS_N];\n"
+           "        //ds_lu is W = I - ds_gamma*tau*J, factored, for DS_JAC_REUSE steps\n"
+           "    int ds_piv[DS_N], ds_i, ds_j, ds_n, ds_jac_ct = DS_JAC_REUSE;\n"
+           "    DS_GET_STATE(ds_out);\n"
+           "    DS_DERIV(ds_out, ds_f);\n";
+    out << "//End CFileBase::WriteRosenbrockInit\n";
+}
+void CFileBase::WriteRungeKutta(std::ofstream& out)
+{
+    //Mirrors RungeKutta::Advance, with the stages unrolled
+    const RungeKutta::METHOD method = RkMethod();
+    const int num_stages = RungeKutta::NumStages(method);
+    const double* a = RungeKutta::A(method);
+    out <<
+           "        //Begin CFileBase::WriteRungeKutta\n"
+           "        DS_GET_STATE(ds_y);\n"
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            if (ds_y[ds_n]!=ds_out[ds_n]) break;\n"
+           "        if (DS_HOLD || ds_n<DS_N) DS_DERIV(ds_y, ds_k[0]);\n"
+           "            //Otherwise the first stage is the derivative at the end of the last step\n";
+    for (int s=1; s<num_stages; ++s)
+        out <<
+               "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+               "            ds_x[ds_n] = ds_y[ds_n] + tau*(" + WeightedSum(a + s*num_stages, s) + ");\n"
+               "        DS_DERIV(ds_x, ds_k[" + std::to_string(s) + "]);\n";
+    out <<
+           "        for (ds_n=0; ds_n<DS_N; ++ds_n)\n"
+           "            ds_out[ds_n] = ds_y[ds_n] += tau*("
+                + WeightedSum(RungeKutta::B(method), num_stages) + ");\n"
+           "        DS_DERIV(ds_y, ds_k[0]);\n"
+           "            //Sets the state, and brings the variables up to date with it\n"
+           "        //End CFileBase::WriteRungeKutta\n";
+}
+void CFileBase::WriteRungeKuttaInit(std::ofstream& out)
+{
+    out << "//Begin CFileBase::WriteRungeKuttaInit\n";
+    out <<
+           "    double ds_k[" + std::to_string(RungeKutta::NumStages(RkMethod())) + "][DS_N],"
+                " ds_x[DS_N], ds_y[DS_N], ds_out[DS_N];\n"
+           "    int ds_n;\n"
+           "    DS_GET_STATE(ds_out);\n"
+           "    DS_DERIV(ds_out, ds_k[0]);\n";
+    out << "//End CFileBase::WriteRungeKuttaInit\n";
+}
+void CFileBase::WriteSolverInit(std::ofstream& out)
+{
+    out << "//Begin CFileBase::WriteSolverInit\n";
+    const ParamModelBase* variables = _modelMgr->Model(ds::VAR),
+            * diffs = _modelMgr->Model(ds::DIFF),
+            * jacs = _modelMgr->Model(ds::JAC);
+    const size_t num_vars = variables->NumPars(),
+            num_diffs = diffs->NumPars();
+
+    //The non-frozen differentials make up the state, and DS_DERIV evaluates the variables
+    //and the derivatives at a state
+    std::string get_state, set_state, var_funcs, diff_funcs, get_deriv;
+    bool hold = false;
+    for (size_t i=0; i<num_vars; ++i)
+        if (!variables->IsFreeze(i) && Input::Type(variables->Value(i))!=Input::USER)
+            hold = true; //Inputs change between model steps
+    var_funcs = ScheduledVars("; \\\n");
+    std::vector<size_t> state_idx;
+    for (size_t i=0; i<num_diffs; ++i)
+    {
+        if (diffs->IsFreeze(i)) continue;
+        const std::string idx = "[" + std::to_string(state_idx.size()) + "]";
+        state_idx.push_back(i);
+        get_state += " (ds_py)" + idx + " = " + diffs->ShortKey(i) + ";";
+        set_state += "        " + diffs->ShortKey(i) + " = (ds_py)" + idx + "; \\\n";
+        diff_funcs += "        " + diffs->ShortKey(i) + "_func(" + FuncArgs(ds::DIFF, i) + "); \\\n";
+        get_deriv += "        (ds_pf)" + idx + " = " + diffs->TempKey(i) + "; \\\n";
+    }
+    const size_t n = state_idx.size();
+
+    out <<
+           "#define DS_N " + std::to_string(n) + "\n"
+           "#define DS_HOLD " + std::to_string(hold ? 1 : 0) + "\n"
+           "#define DS_GET_STATE(ds_py) do {" + get_state + " } while (0)\n"
+           "#define DS_DERIV(ds_py, ds_pf) do { \\\n"
+           + set_state + var_funcs + diff_funcs + get_deriv +
+           "    } while (0)\n";
+
+    bool has_jac = jacs->NumPars()==num_diffs*num_diffs;
+    for (size_t k=0; has_jac && k<jacs->NumPars(); ++k)
+        if (jacs->Value(k).empty()) has_jac = false;
+    if (_modelMgr->DiffMethod()==ModelMgr::ROSENBROCK && has_jac)
+    {
+        //The Jacobian of the state, from the entries of the Jacobian model for the non-frozen
+        //differentials
+        std::string get_jac;
+        for (size_t a=0; a<n; ++a)
+            for (size_t b=0; b<n; ++b)
+                get_jac += "        (ds_pj)[" + std::to_string(a*n + b) + "] = "
+                        + PreprocessExprn(jacs->Value(state_idx[a]*num_diffs + state_idx[b]))
+                        + "; \\\n";
+        out <<
+               "#define DS_JAC(ds_py, ds_pj) do { \\\n"
+               + set_state + var_funcs + get_jac +
+               "    } while (0)\n";
+    }
+
+    switch (_modelMgr->DiffMethod())
+    {
+        case ModelMgr::DORMAND_PRINCE:
+            WriteDormandPrinceInit(out);
+            break;
+        case ModelMgr::ROSENBROCK:
+            WriteRosenbrockInit(out);
+            break;
+        default:
+            WriteRungeKuttaInit(out);
+            break;
+    }
+    out << "//End CFileBase::WriteSolverInit\n";
+}
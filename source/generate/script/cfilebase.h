@@ -2,6 +2,7 @@
 #define CFILEBASE_H
 
 #include <fstream>
+#include <sstream>
 
 #include <QFile>
 #include <QFileInfo>
@@ -26,10 +27,12 @@ class CFileBase : public QObject
     protected:
         virtual std::string FuncArgs(ds::PMODEL, size_t) const { return ""; }
         std::string PreprocessExprn(const std::string& exprn) const;
+        std::string ScheduledVars(const std::string& line_end) const;
+            //The user variable functions, each group followed by its copy-backs
         virtual void MakeHFile() = 0;
         virtual std::string Suffix() const = 0;
 
-        void WriteConditions(std::ofstream& out);
+        virtual void WriteConditions(std::ofstream& out);
         virtual void WriteDataOut(std::ofstream& out, ds::PMODEL mi) = 0;
         virtual void WriteExecVarsDiffs(std::ofstream& out);
         virtual void WriteExtraFuncs(std::ofstream&) {}
@@ -44,6 +47,8 @@ class CFileBase : public QObject
         virtual void WriteModelLoopEnd(std::ofstream& out);
         virtual void WriteLoadInput(std::ofstream& out);
         virtual void WriteOutputHeader(std::ofstream& out) = 0;
+        virtual void WriteRandFuncs(std::ofstream& out);
+        virtual void WriteRandInput(std::ofstream& out);
         virtual void WriteSave(std::ofstream&);
         virtual void WriteSaveBlockBegin(std::ofstream&) {}
         virtual void WriteSaveBlockEnd(std::ofstream&) {}
@@ -51,9 +56,24 @@ class CFileBase : public QObject
 
         Log* const _log;
         ModelMgr* const _modelMgr;
+        ExprnSchedule _schedule;
 
     private:
+        static const int RAND_BLOCK;
+
+        bool HasRandInput() const;
         std::string MakeName(const std::string& name) const;
+        std::string RandArgs(size_t var_idx) const; //The dist, seed, and stream of ds_rand_fill
+        RungeKutta::METHOD RkMethod() const;
+        bool UsesSolver() const; //A DiffSolver diff method, with something to integrate
+        std::string WeightedSum(const double* w, int num) const; //Of the stages ds_k, at ds_n
+        void WriteDormandPrince(std::ofstream& out);
+        void WriteDormandPrinceInit(std::ofstream& out);
+        void WriteRosenbrock(std::ofstream& out);
+        void WriteRosenbrockInit(std::ofstream& out);
+        void WriteRungeKutta(std::ofstream& out);
+        void WriteRungeKuttaInit(std::ofstream& out);
+        void WriteSolverInit(std::ofstream& out); //The macros the solvers share
 
         const std::string _nameBase, _nameExtension;
 };
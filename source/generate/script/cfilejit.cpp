@@ -0,0 +1,162 @@
+#include "cfilejit.h"
+
+const std::string CFileJit::STEP_FUNC = "ds_jit_step";
+const std::string CFileJit::DATA_ARR = "ds_data_";
+const std::string CFileJit::TEMP_ARR = "ds_temp_";
+const std::string CFileJit::NUM_PTS = "ds_n_";
+const std::string CFileJit::PT_IDX = "ds_i_";
+
+CFileJit::CFileJit(const std::string& name, const ExprnSchedule& schedule)
+    : CFileBase(name, ".c")
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("CFileJit::CFileJit", std::this_thread::get_id());
+#endif
+    _schedule = schedule;
+}
+
+std::string CFileJit::FuncArgs(ds::PMODEL, size_t) const
+{
+    return DATA_ARR + ", " + TEMP_ARR + ", " + NUM_PTS + ", " + PT_IDX;
+}
+
+void CFileJit::WriteExecVarsDiffs(std::ofstream& out)
+{
+    out << "//Begin CFileJit::WriteExecVarsDiffs\n";
+    const ParamModelBase* variables = _modelMgr->Model(ds::VAR);
+    const size_t num_vars = variables->NumPars();
+    for (size_t i=0; i<num_vars; ++i)
+        if (variables->IsFreeze(i))
+            out << "        " + variables->TempKey(i) + " = " + FreezeValue(ds::VAR, i) + ";\n";
+    for (size_t i=0; i<num_vars; ++i)
+        if (variables->IsFreeze(i) || Input::Type(variables->Value(i))!=Input::USER)
+            out << "        " + variables->ShortKey(i) + " = " + variables->TempKey(i) + ";\n";
+    out << ScheduledVars(";\n");
+    out << "\n";
+
+    const ds::PMODEL models[] = {ds::DIFF, ds::NC, ds::JAC};
+    for (auto mi : models)
+    {
+        const ParamModelBase* model = _modelMgr->Model(mi);
+        const size_t num_pars = model->NumPars();
+        for (size_t i=0; i<num_pars; ++i)
+            if (model->IsFreeze(i))
+                out << "        " + model->TempKey(i) + " = " + FreezeValue(mi, i) + ";\n";
+            else if (!model->TempExpression(i).empty())
+                out << "        " + model->ShortKey(i) + "_func(" + FuncArgs(mi, i) + ");\n";
+    }
+    out << "//End CFileJit::WriteExecVarsDiffs\n";
+    out << "\n";
+}
+
+void CFileJit::WriteExtraFuncs(std::ofstream& out)
+{
+    WriteFuncs(out, ds::NC);
+    WriteFuncs(out, ds::JAC);
+}
+
+void CFileJit::WriteFuncs(std::ofstream& out, ds::PMODEL mi)
+{
+    out << "//Begin CFileJit::WriteFuncs\n";
+    const ParamModelBase* model = _modelMgr->Model(mi);
+    const size_t num_pars = model->NumPars();
+    for (size_t i=0; i<num_pars; ++i)
+    {
+        if (mi==ds::VAR && Input::Type(model->Value(i))!=Input::USER) continue;
+        const std::string exprn = model->TempExprnForCFile(i);
+        if (exprn.empty()) continue;
+        out <<
+               "static inline void " + model->ShortKey(i) + "_func(" + FuncParams() + ")\n"
+               "{\n"
+               "    " + PreprocessExprn( _schedule.Specialize(exprn, true) ) + ";\n"
+               "}\n";
+    }
+    out << "//End CFileJit::WriteFuncs\n";
+    out << "\n";
+}
+
+void CFileJit::WriteGlobalConst(std::ofstream& out)
+{
+    out << "//Begin CFileJit::WriteGlobalConst\n";
+    out << "static const double tau = " << _modelMgr->ModelStepStr() << ";\n";
+    out << "static const double _pi = 3.141592653589793238462643;\n";
+    out << "static const double _e = 2.718281828459045235360287;\n";
+    out << "static inline double sign(double x) { return (x>0) - (x<0); }\n";
+    out << "//End CFileJit::WriteGlobalConst\n";
+    out << "\n";
+}
+
+void CFileJit::WriteIncludes(std::ofstream& out)
+{
+    out << "//Begin CFileJit::WriteIncludes\n";
+    out << "#include \"math.h\"\n";
+    out << "#include \"stddef.h\"\n";
+    out << "//End CFileJit::WriteIncludes\n";
+    out << "\n";
+}
+
+void CFileJit::WriteMainBegin(std::ofstream& out)
+{
+    out <<
+           "void " + STEP_FUNC + "(double* const* " + DATA_ARR + ", double* const* " + TEMP_ARR
+                + ", size_t " + NUM_PTS + ")\n"
+           "{\n";
+}
+
+void CFileJit::WriteMainEnd(std::ofstream& out)
+{
+    out << "}\n";
+}
+
+void CFileJit::WriteModelLoopBegin(std::ofstream& out)
+{
+    out << "    for (size_t " + PT_IDX + "=0; " + PT_IDX + "<" + NUM_PTS + "; ++" + PT_IDX + ")\n"
+           "    {\n";
+}
+
+void CFileJit::WriteModelLoopEnd(std::ofstream& out)
+{
+    out << "    }\n";
+}
+
+//Rather than declaring globals, every parameter name is mapped onto its slot in the
+//ParserMgr arrays, indexed by ds::PMODEL, so that the expressions can be used unaltered.
+//  Each parameter occupies NUM_PTS consecutive elements, one per point being evaluated; a
+//single step is just the case NUM_PTS==1.
+void CFileJit::WriteVarDecls(std::ofstream& out)
+{
+    out << "//Begin CFileJit::WriteVarDecls\n";
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+    {
+        const ds::PMODEL mi = (ds::PMODEL)i;
+        if (!IsJitModel(mi)) continue;
+        const ParamModelBase* model = _modelMgr->Model(mi);
+        const size_t num_pars = model->NumPars();
+        for (size_t k=0; k<num_pars; ++k)
+        {
+            const std::string slot = "[" + std::to_string(i) + "][" + std::to_string(k) + "*"
+                    + NUM_PTS + "+" + PT_IDX + "])";
+            out << "#define " + model->ShortKey(k) + " (" + DATA_ARR + slot + "\n";
+            if (model->DoEvaluate())
+                out << "#define " + model->TempKey(k) + " (" + TEMP_ARR + slot + "\n";
+        }
+    }
+    out << "//End CFileJit::WriteVarDecls\n";
+    out << "\n";
+}
+
+bool CFileJit::IsJitModel(ds::PMODEL mi) const
+{
+    return mi!=ds::INIT && mi!=ds::COND;
+}
+std::string CFileJit::FuncParams() const
+{
+    return "double* const* " + DATA_ARR + ", double* const* " + TEMP_ARR
+            + ", size_t " + NUM_PTS + ", size_t " + PT_IDX;
+}
+std::string CFileJit::FreezeValue(ds::PMODEL mi, size_t idx) const
+{
+    return (mi==ds::DIFF && !_modelMgr->HasSolver())
+            ? PreprocessExprn( _modelMgr->Model(ds::INIT)->Value(idx) )
+            : "0"; //With a DiffSolver, differential temporaries are derivatives
+}
@@ -0,0 +1,52 @@
+#ifndef CFILEJIT_H
+#define CFILEJIT_H
+
+#include "cfilebase.h"
+
+//Writes a single model step that operates directly on the ParserMgr data arrays, for
+//in-process evaluation.  The step can be applied to a batch of points at once, for which the
+//arrays are laid out as structure-of-arrays.  The step function mirrors what ParserMgr's main parser does on each
+//Eval, in the same ExprnSchedule:  temporaries are computed and variables copied back, while the
+//copy of the temporaries into the data arrays, inputs, and conditions are left to ParserMgr.
+class CFileJit : public CFileBase
+{
+    public:
+        static const std::string STEP_FUNC;
+
+        CFileJit(const std::string& name, const ExprnSchedule& schedule);
+            //schedule:  the ParserMgr's, so that both leave out the same variables
+
+    protected:
+        virtual std::string FuncArgs(ds::PMODEL, size_t) const override;
+        virtual void MakeHFile() override {}
+        virtual std::string Suffix() const override { return ""; }
+
+        virtual void WriteConditions(std::ofstream&) override {}
+        virtual void WriteDataOut(std::ofstream&, ds::PMODEL) override {}
+        virtual void WriteExecVarsDiffs(std::ofstream& out) override;
+        virtual void WriteExtraFuncs(std::ofstream& out) override;
+        virtual void WriteFuncs(std::ofstream& out, ds::PMODEL mi) override;
+        virtual void WriteGlobalConst(std::ofstream& out) override;
+        virtual void WriteIncludes(std::ofstream& out) override;
+        virtual void WriteInitArgs(std::ofstream&) override {}
+        virtual void WriteInitVarsDiffs(std::ofstream&) override {}
+        virtual void WriteLoadInput(std::ofstream&) override {}
+        virtual void WriteMainBegin(std::ofstream& out) override;
+        virtual void WriteMainEnd(std::ofstream& out) override;
+        virtual void WriteModelLoopBegin(std::ofstream& out) override;
+        virtual void WriteModelLoopEnd(std::ofstream& out) override;
+        virtual void WriteOutputHeader(std::ofstream&) override {}
+        virtual void WriteRandFuncs(std::ofstream&) override {}
+        virtual void WriteRandInput(std::ofstream&) override {}
+        virtual void WriteSave(std::ofstream&) override {}
+        virtual void WriteVarDecls(std::ofstream& out) override;
+
+    private:
+        static const std::string DATA_ARR, TEMP_ARR, NUM_PTS, PT_IDX;
+
+        bool IsJitModel(ds::PMODEL mi) const;
+        std::string FreezeValue(ds::PMODEL mi, size_t idx) const;
+        std::string FuncParams() const;
+};
+
+#endif // CFILEJIT_H
@@ -111,7 +111,7 @@ void CudaKernel::WriteFuncs(std::ofstream& out, ds::PMODEL mi)
     for (size_t i=0; i<num_pars; ++i)
     {
         std::string value = model->Value(i);
-        if (Input::Type(value)==Input::INPUT_FILE) continue;
+        if (Input::Type(value)!=Input::USER) continue; //Input files and random inputs
         out <<
                "__device__ void " + model->ShortKey(i) + "_func(double " + STATE_ARR + "[])\n"
                "{\n"
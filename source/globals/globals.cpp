@@ -5,7 +5,6 @@ const int ds::MAX_NUM_PARS = 1024;
 const double ds::PI = 3.14159265358979;
 const int ds::TABLEN = 4;
 
-const std::string ds::TEMP_FILE = ".temp.txt";
 const std::string ds::TEMP_DAT_FILE = ".temp.dsdat";
 const std::string ds::TEMP_MODEL_FILE = ".temp_model.txt";
 const std::string ds::VERSION_STR = "0.4.0";
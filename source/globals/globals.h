@@ -47,7 +47,6 @@ namespace ds
     extern const double PI;
     extern const int TABLEN;
 
-    extern const std::string TEMP_FILE;
     extern const std::string TEMP_DAT_FILE;
     extern const std::string TEMP_MODEL_FILE;
     extern const std::string VERSION_STR;
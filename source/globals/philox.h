@@ -0,0 +1,71 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <cmath>
+#include <cstdint>
+
+//Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").  A counter based
+//generator:  draw k of a stream is a pure function of (seed, stream, k), so any draw can be
+//computed on demand, and streams with different keys never overlap.  CFileBase::WriteRandFuncs
+//writes the same generator into compiled models, so keep the two in step.
+class Philox
+{
+    public:
+        Philox(uint32_t seed, uint32_t stream)
+        {
+            _key[0] = seed;
+            _key[1] = stream;
+        }
+
+        inline void Block(uint64_t counter, uint32_t* out) const //Four words
+        {
+            uint32_t c[4] = { (uint32_t)counter, (uint32_t)(counter >> 32), 0, 0 },
+                    k[2] = { _key[0], _key[1] };
+            for (int r=0; r<10; ++r)
+            {
+                const uint64_t p0 = (uint64_t)0xD2511F53 * c[0],
+                        p1 = (uint64_t)0xCD9E8D57 * c[2];
+                const uint32_t c0 = (uint32_t)(p1 >> 32) ^ c[1] ^ k[0],
+                        c2 = (uint32_t)(p0 >> 32) ^ c[3] ^ k[1];
+                c[1] = (uint32_t)p1;
+                c[3] = (uint32_t)p0;
+                c[0] = c0;
+                c[2] = c2;
+                k[0] += 0x9E3779B9;
+                k[1] += 0xBB67AE85;
+            }
+            for (int i=0; i<4; ++i)
+                out[i] = c[i];
+        }
+
+        inline double Uniform(uint64_t k) const //[0,1)
+        {
+            uint32_t w[4];
+            Block(k, w);
+            return ToUnit(w[0], w[1]);
+        }
+        inline double Normal(uint64_t k) const //Box-Muller
+        {
+            uint32_t w[4];
+            Block(k, w);
+            const double two_pi = 6.283185307179586,
+                    u1 = 1.0 - ToUnit(w[0], w[1]); //(0,1]
+            return std::sqrt(-2.0*std::log(u1)) * std::cos(two_pi*ToUnit(w[2], w[3]));
+        }
+        inline double Exponential(uint64_t k) const //Unit rate, i.e. gamma(1,1)
+        {
+            uint32_t w[4];
+            Block(k, w);
+            return -std::log(1.0 - ToUnit(w[0], w[1]));
+        }
+
+    private:
+        static inline double ToUnit(uint32_t hi, uint32_t lo) //53 bits
+        {
+            return (double)( (((uint64_t)hi << 32) | lo) >> 11 ) * (1.0/9007199254740992.0);
+        }
+
+        uint32_t _key[2];
+};
+
+#endif // PHILOX_H
@@ -0,0 +1,79 @@
+#include "workerpool.h"
+
+WorkerPool::WorkerPool() : _stop(false)
+{
+    const size_t num_cores = std::thread::hardware_concurrency(),
+            num_workers = num_cores>1 ? num_cores-1 : 0; //The caller works too
+    for (size_t i=0; i<num_workers; ++i)
+        _workers.push_back( std::thread(&WorkerPool::WorkerLoop, this, i) );
+}
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    for (auto& it : _workers)
+        it.join();
+}
+
+void WorkerPool::Run(size_t num_tasks, const Task& task)
+{
+    if (num_tasks==0) return;
+    Job job(task, num_tasks);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (num_tasks>1 && !_workers.empty())
+    {
+        _jobs.push_back(&job);
+        _cv.notify_all();
+    }
+    Work(&job, _workers.size(), lock);
+
+    job.done.wait(lock, [&]() { return job.num_done==job.num_tasks; });
+    if (job.except) std::rethrow_exception(job.except);
+}
+
+bool WorkerPool::Claim(Job* job, size_t* task)
+{
+    if (job->next==job->num_tasks) return false;
+    *task = job->next++;
+    if (job->next==job->num_tasks)
+    {
+        auto it = std::find(_jobs.begin(), _jobs.end(), job);
+        if (it!=_jobs.end()) _jobs.erase(it);
+    }
+    return true;
+}
+void WorkerPool::Work(Job* job, size_t slot, std::unique_lock<std::mutex>& lock)
+{
+    size_t t;
+    while (Claim(job, &t))
+    {
+        std::exception_ptr except;
+        lock.unlock();
+        try
+        {
+            job->task(t, slot);
+        }
+        catch (...)
+        {
+            except = std::current_exception();
+        }
+        lock.lock();
+
+        if (except && !job->except) job->except = except;
+        if (++job->num_done==job->num_tasks) job->done.notify_all();
+    }
+}
+void WorkerPool::WorkerLoop(size_t slot)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true)
+    {
+        _cv.wait(lock, [&]() { return _stop || !_jobs.empty(); });
+        if (_stop) return;
+        Work(_jobs.front(), slot, lock);
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//A fixed set of worker threads shared by everything that wants to split a computation into
+//independent tasks.  Run hands out the tasks of one job to the workers and to the calling
+//thread, and returns once all of them are done.  Each task is told which slot it is running
+//in; no two tasks of a job ever run in the same slot at the same time, so callers can keep
+//per-slot state (a ParserMgr, a scratch buffer) indexed by it.
+class WorkerPool
+{
+    public:
+        typedef std::function<void(size_t task, size_t slot)> Task;
+
+        inline static WorkerPool* Instance()
+        {
+            static WorkerPool* instance = new WorkerPool();
+            return instance;
+        }
+
+        ~WorkerPool();
+
+        void Run(size_t num_tasks, const Task& task);
+            //Rethrows the first exception thrown by any task, after all tasks have finished
+
+        size_t NumSlots() const { return _workers.size() + 1; } //Workers plus the caller
+
+    private:
+        struct Job
+        {
+            Job(const Task& task_, size_t num_tasks_)
+                : task(task_), num_tasks(num_tasks_), next(0), num_done(0)
+            {}
+            const Task& task;
+            const size_t num_tasks;
+            size_t next, num_done;
+            std::exception_ptr except;
+            std::condition_variable done;
+        };
+
+        WorkerPool();
+#ifdef __GNUG__
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+#endif
+
+        bool Claim(Job* job, size_t* task);
+        void Work(Job* job, size_t slot, std::unique_lock<std::mutex>& lock);
+            //Runs tasks of job until none are left unclaimed.  Everything touching the job
+            //happens under lock, since the job is gone as soon as its last task is done.
+        void WorkerLoop(size_t slot);
+
+        std::condition_variable _cv;
+        std::deque<Job*> _jobs;
+        std::mutex _mutex;
+        bool _stop;
+        std::vector<std::thread> _workers;
+};
+
+#endif // WORKERPOOL_H
@@ -2,6 +2,7 @@
 #include "ui_fastrungui.h"
 
 const int FastRunGui::DEFAULT_DURATION = 100;
+const int FastRunGui::DEFAULT_INITS = 1;
 const int FastRunGui::DEFAULT_MODN = 1000;
 
 FastRunGui::FastRunGui(QWidget *parent) :
@@ -11,6 +12,7 @@ FastRunGui::FastRunGui(QWidget *parent) :
     ui->setupUi(this);
     ui->edDuration->setText(QString("%1").arg(DEFAULT_DURATION));
     ui->edSaveModN->setText(QString("%1").arg(DEFAULT_MODN));
+    ui->edInitsPerVariant->setText(QString("%1").arg(DEFAULT_INITS));
     ui->edFullFileName->setText(FullFileName().c_str());
     setWindowTitle("Run Simulation Offline");
 }
@@ -50,23 +52,16 @@ void FastRunGui::showEvent(QShowEvent*)
         case UNKNOWN:
             throw std::runtime_error("FastRunGui::showEvent: Bad Method");
         case FAST_RUN:
+        case ENSEMBLE:
             ui->prgSimulation->show();
             ui->prgSimulation->setValue(0);
-            if (_fileName==ds::TEMP_DAT_FILE)
-            {
-                _fileName = ds::TEMP_FILE;
-                ui->edFullFileName->setText(FullFileName().c_str());
-            }
             break;
         case COMPILED:
             ui->prgSimulation->hide();
-            if (_fileName==ds::TEMP_FILE)
-            {
-                _fileName = ds::TEMP_DAT_FILE;
-                ui->edFullFileName->setText(FullFileName().c_str());
-            }
             break;
     }
+    ui->lblInitsPerVariant->setVisible(_method==ENSEMBLE);
+    ui->edInitsPerVariant->setVisible(_method==ENSEMBLE);
 }
 
 void FastRunGui::on_btnFileName_clicked()
@@ -85,10 +80,8 @@ void FastRunGui::on_btnFileName_clicked()
         case UNKNOWN:
             throw std::runtime_error("FastRunGui::on_btnFileName_clicked: Bad method");
         case FAST_RUN:
-            if (pos==std::string::npos || _fileName.substr(pos) != ".txt")
-                _fileName += ".txt";
-            break;
         case COMPILED:
+        case ENSEMBLE:
             if (pos==std::string::npos || _fileName.substr(pos) != ".dsdat")
                 _fileName += ".dsdat";
             break;
@@ -115,6 +108,13 @@ void FastRunGui::on_btnStartFast_clicked()
                 emit StartCompiled(duration, save_mod_n);
                 close();
                 break;
+            case ENSEMBLE:
+                ui->prgSimulation->setMinimum(0);
+                ui->prgSimulation->setMaximum(duration);
+                emit StartEnsemble(duration, save_mod_n,
+                                   std::max(ui->edInitsPerVariant->text().toInt(), 1));
+                ui->btnStartFast->setText("Cancel");
+                break;
         }
     }
     else
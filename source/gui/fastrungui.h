@@ -20,7 +20,8 @@ class FastRunGui : public QWidget
         {
             UNKNOWN,
             FAST_RUN,
-            COMPILED
+            COMPILED,
+            ENSEMBLE
         };
 
         explicit FastRunGui(QWidget *parent = 0);
@@ -40,6 +41,7 @@ class FastRunGui : public QWidget
 
     signals:
         void StartCompiled(int duration, int save_mod_n);
+        void StartEnsemble(int duration, int save_mod_n, int inits_per_variant);
         void StartFastRun(int duration, int save_mod_n);
         void Finished();
 
@@ -52,6 +54,7 @@ class FastRunGui : public QWidget
         Ui::FastRunGui *ui;
 
         static const int DEFAULT_DURATION,
+                        DEFAULT_INITS,
                         DEFAULT_MODN;
 
         std::string _fileName;
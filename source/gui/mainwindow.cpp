@@ -7,6 +7,7 @@ const int MainWindow::DEFAULT_VF_RES = 20;
 const int MainWindow::DEFAULT_VF_STEP = 1;
 const int MainWindow::DEFAULT_VF_TAIL = 1;
 const int MainWindow::MAX_BUF_SIZE = 8 * 1024 * 1024;
+const double MainWindow::DEFAULT_NC_MIN_CELL = 1.0 / 2048.0;
 const double MainWindow::MIN_MODEL_STEP = 1e-7;
 const int MainWindow::PLOT_REFRESH = 50;
 const int MainWindow::SLIDER_INT_LIM = 10000;
@@ -53,7 +54,7 @@ MainWindow::MainWindow(QWidget *parent) :
 //    ui->qwtTimePlot->setAutoReplot(true);
 
     QStringList diff_methods;
-    diff_methods << "Euler" << "Euler2" << "Runge-Kutta";
+    diff_methods << "Euler" << "Euler2" << "Runge-Kutta" << "Dormand-Prince" << "Rosenbrock";
     ui->cmbDiffMethod->setModel( new QStringListModel(diff_methods) );
 
     QStringList modes;
@@ -88,6 +89,7 @@ MainWindow::MainWindow(QWidget *parent) :
 
     connect(_fastRunGui, SIGNAL(StartCompiled(int,int)), this, SLOT(StartCompiled(int,int)));
     connect(_fastRunGui, SIGNAL(StartFastRun(int,int)), this, SLOT(StartFastRun(int,int)), Qt::DirectConnection);
+    connect(_fastRunGui, SIGNAL(StartEnsemble(int,int,int)), this, SLOT(StartEnsemble(int,int,int)));
     connect(_fastRunGui, SIGNAL(Finished()), this, SLOT(FastRunFinished()));
     connect(this, SIGNAL(UpdateSimPBar(int)), _fastRunGui, SLOT(UpdatePBar(int)));
     connect(_logGui, SIGNAL(ShowParser()), this, SLOT(ParserToLog()));
@@ -120,7 +122,7 @@ MainWindow::~MainWindow()
 #endif
     _drawMgr->Stop();
     delete ui;
-    QFile temp_file(ds::TEMP_FILE.c_str());
+    QFile temp_file(ds::TEMP_DAT_FILE.c_str());
     if (temp_file.exists()) temp_file.remove();
 }
 void MainWindow::ExecutableFinished(int id, bool is_normal)
@@ -158,6 +160,11 @@ void MainWindow::FastRunFinished()
     _drawMgr->Stop();
     ui->btnStart->setText("Start");
     StopEventViewer();
+    if (_ensemble)
+    {
+        _ensemble->Cancel();
+        _ensemble.reset();
+    }
 }
 void MainWindow::Error()
 {
@@ -305,6 +312,31 @@ void MainWindow::StartCompiled(int duration, int save_mod_n) //slot
 
     setEnabled(true);
 }
+void MainWindow::StartEnsemble(int duration, int save_mod_n, int inits_per_variant) //slot
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MainWindow::StartEnsemble", std::this_thread::get_id());
+#endif
+    _numSimSteps = duration;
+    _saveModN = save_mod_n;
+    _drawMgr->ClearObjects();
+
+    //Every parameter variant, from the current initial conditions or from several drawn from
+    //the INIT ranges
+    std::vector<int> variants(_modelMgr->NumParVariants());
+    for (size_t i=0; i<variants.size(); ++i)
+        variants[i] = (int)i;
+    const size_t num_steps = (size_t)(duration / _modelMgr->ModelStep() + 0.5);
+    _ensemble = std::make_shared<Ensemble>(variants, (size_t)inits_per_variant, num_steps,
+                                           save_mod_n);
+    _ensemble->SetProgressFunc([=](double frac)
+    {
+        emit UpdateSimPBar( (int)(frac*duration) );
+    });
+
+    std::thread t( std::bind(&MainWindow::DoEnsemble, this, _ensemble) );
+    t.detach();
+}
 void MainWindow::StartFastRun(int duration, int save_mod_n)
 {
 #ifdef DEBUG_FUNC
@@ -614,6 +646,13 @@ void MainWindow::on_actionLoad_triggered()
     LoadModel(_fileName);
 }
 
+void MainWindow::on_actionLocate_Events_triggered(bool checked)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MainWindow::on_actionLocate_Events_triggered", _tid);
+#endif
+    _modelMgr->SetLocateEvents(checked);
+}
 void MainWindow::on_actionLog_triggered()
 {
 #ifdef DEBUG_FUNC
@@ -682,6 +721,15 @@ void MainWindow::on_actionReload_Current_triggered()
     else LoadModel(_fileName);
 }
 
+void MainWindow::on_actionRun_Ensemble_triggered()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MainWindow::on_actionRun_Ensemble_triggered", _tid);
+#endif
+    _fastRunGui->SetMethod(FastRunGui::ENSEMBLE);
+    _fastRunGui->show();
+    setEnabled(false);
+}
 void MainWindow::on_actionRun_Offline_triggered()
 {
 #ifdef DEBUG_FUNC
@@ -697,7 +745,7 @@ void MainWindow::on_actionSave_Data_triggered()
 #ifdef DEBUG_FUNC
     ScopeTracker st("MainWindow::on_actionSave_Data_triggered", _tid);
 #endif
-    if ( !QFile(ds::TEMP_FILE.c_str()).exists() ) return;
+    if ( !QFile(ds::TEMP_DAT_FILE.c_str()).exists() ) return;
     std::string file_name = QFileDialog::getSaveFileName(nullptr,
                                                          "Save generated data",
                                                          DDM::SaveDataDir().c_str()).toStdString();
@@ -1051,6 +1099,14 @@ void MainWindow::on_cboxFitView_stateChanged(int state)
         }
     }
 }
+void MainWindow::on_cboxNCAdaptive_stateChanged(int state)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MainWindow::on_cboxNCAdaptive_stateChanged", _tid);
+#endif
+    _drawMgr->SetGlobalSpec("adaptive", state==Qt::Checked);
+        //Uniform marching squares unless asked for
+}
 void MainWindow::on_cboxNullclines_stateChanged(int state)
 {
 #ifdef DEBUG_FUNC
@@ -1105,6 +1161,10 @@ void MainWindow::on_cmbDiffMethod_currentIndexChanged(const QString& text)
         _modelMgr->SetDiffMethod(ModelMgr::EULER);
     else if (text=="Euler2")
         _modelMgr->SetDiffMethod(ModelMgr::EULER2);
+    else if (text=="Dormand-Prince")
+        _modelMgr->SetDiffMethod(ModelMgr::DORMAND_PRINCE);
+    else if (text=="Rosenbrock")
+        _modelMgr->SetDiffMethod(ModelMgr::ROSENBROCK);
     else
         _modelMgr->SetDiffMethod(ModelMgr::RUNGE_KUTTA);
 }
@@ -1374,6 +1434,26 @@ void MainWindow::ConnectModels()
     else
         ResetResultsList(0);
 }
+void MainWindow::DoEnsemble(std::shared_ptr<Ensemble> ensemble)
+{
+    ds::AddThread(std::this_thread::get_id());
+#ifdef DEBUG_FUNC
+    ScopeTracker::InitThread(std::this_thread::get_id());
+    ScopeTracker st("MainWindow::DoEnsemble", std::this_thread::get_id());
+#endif
+    try
+    {
+        ensemble->Run( _fastRunGui->FullFileName() );
+        if (ensemble->IsCancelled()) return;
+        _log->AddMesg("Ensemble of " + std::to_string(ensemble->NumRuns()) + " runs saved to "
+                      + _fastRunGui->FullFileName());
+    }
+    catch (std::exception& e)
+    {
+        _log->AddExcept("MainWindow::DoEnsemble: " + std::string(e.what()));
+    }
+    emit UpdateSimPBar(-1);
+}
 void MainWindow::DoFastRun()
 {
     ds::AddThread(std::this_thread::get_id());
@@ -1387,6 +1467,7 @@ void MainWindow::DoFastRun()
 
     pp->SetSpec("make_plots", false);
     pp->SetSpec("is_recording", true);
+    pp->SetSpec("save_mod_n", _saveModN);
     disconnect(pp, SIGNAL(Flag1()), this, SLOT(UpdatePulseParam()));
     disconnect(pp, SIGNAL(Flag2()), this, SLOT(UpdateTPData()));
 
@@ -1539,18 +1620,17 @@ void MainWindow::ExprnChanged(QModelIndex, QModelIndex) //slot
 #endif
     _drawMgr->SetNeedRecompute();
 }
-void MainWindow::ParamChanged(QModelIndex topLeft, QModelIndex) //slot
+void MainWindow::ParamChanged(QModelIndex, QModelIndex) //slot
 {
 #ifdef DEBUG_FUNC
     assert(std::this_thread::get_id()==_tid && "Thread error: MainWindow::ParamChanged");
 #endif
-    int idx = topLeft.row();
-    std::string exprn = _modelMgr->Model(ds::INP)->Expression(idx);
-//std::cerr << exprn << std::endl;
     if (_modelMgr->AreModelsInitialized())
         try
         {
-            _drawMgr->QuickEval(exprn);
+            _drawMgr->UpdateParsers();
+                //Values go straight into the data; frozen and folded parameters are
+                //specialized, so the expressions are set again
 //            _drawMgr->Start(DrawBase::VECTOR_FIELD, 1);
         }
         catch (std::exception& e)
@@ -1823,7 +1903,7 @@ void MainWindow::SaveData(const std::string& file_name)
     DDM::SetSaveDataDir(path);
     QFile old(file_name.c_str());
     if (old.exists()) old.remove();
-    if ( !QFile::rename(ds::TEMP_FILE.c_str(), file_name.c_str()) )
+    if ( !QFile::rename(ds::TEMP_DAT_FILE.c_str(), file_name.c_str()) )
         _log->AddExcept(" : Save of \"" + file_name + "\" failed.");
 }
 void MainWindow::SaveModel(const std::string& file_name)
@@ -2050,10 +2130,13 @@ void MainWindow::UpdateDOSpecs(DrawBase::DRAW_TYPE draw_type)
             draw_object->SetSpec("xidx", ui->cmbPlotX->currentIndex());
             draw_object->SetSpec("yidx", ui->cmbPlotY->currentIndex());
             draw_object->SetSpec("resolution", ui->spnVFResolution->value());
+            draw_object->SetSpec("adaptive", ui->cboxNCAdaptive->isChecked());
+            draw_object->SetSpec("min_cell_size", DEFAULT_NC_MIN_CELL);
             draw_object->SetOpaqueSpec("colors", &_tpColors);
             break;
         case DrawBase::SINGLE:
             draw_object->SetSpec("is_recording", ui->cboxRecord->isChecked());
+            draw_object->SetSpec("save_mod_n", 1);
             draw_object->SetSpec("pulse_steps_remaining", _pulseStepsRemaining);
             draw_object->SetSpec("xidx", ui->cmbPlotX->currentIndex());
             draw_object->SetSpec("yidx", ui->cmbPlotY->currentIndex());
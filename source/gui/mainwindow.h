@@ -33,6 +33,7 @@
 #include "../file/sysfileout.h"
 #include "../globals/scopetracker.h"
 #include "../memrep/drawmgr.h"
+#include "../memrep/ensemble.h"
 #include "../memrep/modelmgr.h"
 #include "../models/tpvtablemodel.h"
 
@@ -85,7 +86,8 @@ class MainWindow : public QMainWindow
                         PLOT_REFRESH,
                         SLIDER_INT_LIM, //Because QSliders have integer increments
                         XY_SAMPLES_SHOWN;
-        static const double MIN_MODEL_STEP;
+        static const double DEFAULT_NC_MIN_CELL, //As a fraction of the axis range
+                        MIN_MODEL_STEP;
             //If Qwt isn't able to draw the samples quickly enough, you get a recursive draw
             //error
 
@@ -105,6 +107,7 @@ class MainWindow : public QMainWindow
         void ParserToLog();
         void Pause();
         void StartCompiled(int duration, int save_mod_n);
+        void StartEnsemble(int duration, int save_mod_n, int inits_per_variant);
         void StartFastRun(int duration, int save_mod_n);
         void StopSimulation();
         void UpdateEquilibria(void* eq);
@@ -130,11 +133,13 @@ class MainWindow : public QMainWindow
         void on_actionEvent_Viewer_triggered();
         void on_actionExit_triggered();
         void on_actionLoad_triggered();
+        void on_actionLocate_Events_triggered(bool checked);
         void on_actionLog_triggered();
         void on_actionMEX_file_with_measure_triggered();
         void on_actionNotes_triggered();
         void on_actionParameters_triggered();
         void on_actionReload_Current_triggered();
+        void on_actionRun_Ensemble_triggered();
         void on_actionRun_Offline_triggered();
         void on_actionSave_Data_triggered();
         void on_actionSave_Model_triggered();
@@ -163,6 +168,7 @@ class MainWindow : public QMainWindow
         void on_btnStart_clicked();
 
         void on_cboxFitView_stateChanged(int state);
+        void on_cboxNCAdaptive_stateChanged(int state);
         void on_cboxNullclines_stateChanged(int state);
         void on_cboxPlotZ_stateChanged(int state);
         void on_cboxVectorField_stateChanged(int state);
@@ -210,6 +216,7 @@ class MainWindow : public QMainWindow
         Executable* CreateExecutable(const std::string& name) const;
         DrawBase* CreateObject(DrawBase::DRAW_TYPE draw_type);
         void ConnectModels();
+        void DoEnsemble(std::shared_ptr<Ensemble> ensemble);
         void DoFastRun();
         void InitDefaultModel();
         void InitViews();
@@ -250,6 +257,7 @@ class MainWindow : public QMainWindow
         UserNullclineGui* const _userNullclineGui;
 
         DrawMgr* const _drawMgr;
+        std::shared_ptr<Ensemble> _ensemble; //Only touched on the GUI thread
         std::vector<ds::Equilibrium*> _equilibria;
         std::string _fileName;
         std::vector<JobRecord> _jobs;
@@ -0,0 +1,29 @@
+#ifndef DIFFSOLVER_H
+#define DIFFSOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+//For diff methods that step the differentials themselves, given just their derivatives,
+//rather than through the differentials' TempExpressions.  Solvers keep state between steps,
+//e.g. a step size or a Jacobian, so each batch point needs its own.
+class DiffSolver
+{
+    public:
+        typedef std::function<void(const double*, double*)> DerivFunc;
+            //Evaluates the derivative (second argument) at a state (first argument)
+        typedef std::function<bool(const double*, double*)> JacFunc;
+            //Evaluates the row major Jacobian at a state; false if there isn't one
+
+        virtual ~DiffSolver() {}
+
+        virtual bool Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                             const JacFunc& jac) = 0;
+            //Moves x forward dt.  Returns true if the last call to deriv was at the new x.
+        virtual void Reset() = 0; //Forget everything carried over from earlier steps
+};
+
+#endif // DIFFSOLVER_H
@@ -0,0 +1,139 @@
+#include "dormandprince.h"
+
+//The last row of A is also the 5th order solution, since the method is first same as last
+const double DormandPrince::A[7][6] = {
+    {0, 0, 0, 0, 0, 0},
+    {1.0/5.0, 0, 0, 0, 0, 0},
+    {3.0/40.0, 9.0/40.0, 0, 0, 0, 0},
+    {44.0/45.0, -56.0/15.0, 32.0/9.0, 0, 0, 0},
+    {19372.0/6561.0, -25360.0/2187.0, 64448.0/6561.0, -212.0/729.0, 0, 0},
+    {9017.0/3168.0, -355.0/33.0, 46732.0/5247.0, 49.0/176.0, -5103.0/18656.0, 0},
+    {35.0/384.0, 0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0}
+};
+const double DormandPrince::C[7] = {0, 1.0/5.0, 3.0/10.0, 4.0/5.0, 8.0/9.0, 1, 1};
+const double DormandPrince::D[7] = { //Dense output, from Hairer's DOPRI5
+    -12715105075.0/11282082432.0, 0, 87487479700.0/32700410799.0,
+    -10690763975.0/1880347072.0, 701980252875.0/199316789632.0,
+    -1453857185.0/822651844.0, 69997945.0/29380423.0
+};
+const double DormandPrince::E[7] = { //5th order minus 4th order solution
+    71.0/57600.0, 0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0, 22.0/525.0, -1.0/40.0
+};
+const double DormandPrince::MAX_FACTOR = 5.0;
+const double DormandPrince::MIN_FACTOR = 0.2;
+const double DormandPrince::MIN_STEP = 1e-12;
+const double DormandPrince::SAFETY = 0.9;
+
+DormandPrince::DormandPrince(double tol, bool hold)
+    : _h(0), _hLast(0), _hold(hold), _isValid(false), _n(0), _t0(0), _t1(0), _tol(tol)
+{
+}
+
+bool DormandPrince::Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                            const JacFunc&)
+{
+    if (!_isValid || n!=_n || !std::equal(x, x+n, _out.cbegin()))
+        Restart(x, n, dt, deriv);
+    else if (_hold)
+        deriv(_x1.data(), _f1.data()); //The inputs have moved on since _f1 was evaluated
+
+    bool at_end = false;
+    while (_t1 < dt)
+    {
+        double h = _h;
+        if (_hold && _t1 + h >= dt)
+        {
+            h = dt - _t1;
+            at_end = true;
+        }
+
+        std::copy(_f1.cbegin(), _f1.cend(), _k.begin());
+        for (int s=1; s<7; ++s)
+        {
+            for (size_t i=0; i<n; ++i)
+            {
+                double sum = 0;
+                for (int j=0; j<s; ++j)
+                    sum += A[s][j] * _k[j*n + i];
+                _stage[i] = _x1[i] + h*sum;
+            }
+            deriv(_stage.data(), &_k[s*n]);
+        }
+            //_stage is now the 5th order solution, and the last row of _k the derivative there
+
+        double err = 0;
+        for (size_t i=0; i<n; ++i)
+        {
+            double e = 0;
+            for (int j=0; j<7; ++j)
+                e += E[j] * _k[j*n + i];
+            const double scale = _tol + _tol*std::max(std::fabs(_x1[i]), std::fabs(_stage[i]));
+            err += (h*e/scale) * (h*e/scale);
+        }
+        err = n ? std::sqrt(err/(double)n) : 0;
+
+        const double factor = (err==0) ? MAX_FACTOR
+                : std::min(MAX_FACTOR, std::max(MIN_FACTOR, SAFETY*std::pow(err, -0.2)));
+        if (err<=1.0 || h<=dt*MIN_STEP)
+        {
+            //Rather than fail, a step of the minimum size is taken regardless
+            _x0.swap(_x1);
+            _x1 = _stage;
+            std::copy(_k.cbegin() + 6*n, _k.cend(), _f1.begin());
+            _t0 = _t1;
+            _t1 = at_end ? dt : _t1 + h;
+            _hLast = h;
+            if (!at_end || factor<1.0) _h = h*factor;
+                //A step shortened to end the interval says nothing about the next one
+        }
+        else
+        {
+            at_end = false;
+            _h = std::max(h*std::min(factor, 1.0), dt*MIN_STEP);
+        }
+    }
+
+    if (_t1==dt)
+        std::copy(_x1.cbegin(), _x1.cend(), x);
+    else
+    {
+        Interpolate((dt - _t0)/_hLast, x);
+        at_end = false;
+    }
+    _t0 -= dt;
+    _t1 -= dt;
+    std::copy(x, x+n, _out.begin());
+    return at_end;
+}
+
+void DormandPrince::Interpolate(double theta, double* x) const
+{
+    const double h = _hLast, theta1 = 1.0 - theta;
+    for (size_t i=0; i<_n; ++i)
+    {
+        const double dx = _x1[i] - _x0[i],
+                bspl = h*_k[i] - dx,
+                r4 = dx - h*_k[6*_n + i] - bspl;
+        double r5 = 0;
+        for (int j=0; j<7; ++j)
+            r5 += D[j] * _k[j*_n + i];
+        r5 *= h;
+        x[i] = _x0[i] + theta*(dx + theta1*(bspl + theta*(r4 + theta1*r5)));
+    }
+}
+void DormandPrince::Restart(const double* x, size_t n, double dt, const DerivFunc& deriv)
+{
+    if (!_isValid || n!=_n) _h = dt;
+        //Otherwise the last step size is likely still a good guess
+    _n = n;
+    _k.assign(7*n, 0);
+    _out.assign(x, x+n);
+    _stage.resize(n);
+    _x0.assign(x, x+n);
+    _x1.assign(x, x+n);
+    _f1.resize(n);
+    deriv(x, _f1.data());
+    _t0 = _t1 = 0;
+    _hLast = 0;
+    _isValid = true;
+}
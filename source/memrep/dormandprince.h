@@ -0,0 +1,46 @@
+#ifndef DORMANDPRINCE_H
+#define DORMANDPRINCE_H
+
+#include "diffsolver.h"
+
+//Dormand-Prince 5(4):  an embedded Runge-Kutta pair, so each step estimates its own error and
+//the step size follows it.  Advance moves the state one output interval, taking as many
+//internal steps as the tolerance needs--possibly none, if the last step already reaches past
+//the interval--and interpolates the output with the method's dense output.  So callers still
+//get uniformly spaced samples, while steps are only as short as the dynamics require.
+//  If the state passed to Advance isn't the one it last returned, e.g. because a condition
+//reset it, the integration restarts from the new state.
+class DormandPrince : public DiffSolver
+{
+    public:
+        DormandPrince(double tol, bool hold);
+            //hold:  don't step past the end of an interval, for when the derivative changes
+            //there, as it does with inputs; each interval then starts from a fresh derivative
+
+        virtual bool Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                             const JacFunc&) override;
+        virtual void Reset() override { _isValid = false; }
+
+        //For generated code, which mirrors Advance
+        static const double A[7][6], C[7], D[7], E[7], MAX_FACTOR, MIN_FACTOR, SAFETY;
+
+    private:
+        static const double MIN_STEP;
+            //Relative to the output interval.  A step this short is accepted whatever its error,
+            //as in the generated code.
+
+        void Interpolate(double theta, double* x) const;
+        void Restart(const double* x, size_t n, double dt, const DerivFunc& deriv);
+
+        double _h, _hLast; //The next step to try, and the last accepted one
+        const bool _hold;
+        bool _isValid;
+        std::vector<double> _k; //Stage derivatives of the last step, 7 rows of _n
+        size_t _n;
+        std::vector<double> _out, _stage, _x0, _x1, _f1;
+            //_x0 and _x1 bracket the last accepted step, and _f1 is the derivative at _x1
+        double _t0, _t1; //The times of _x0 and _x1, relative to the last output
+        const double _tol; //Absolute and relative
+};
+
+#endif // DORMANDPRINCE_H
@@ -150,6 +150,15 @@ void DrawMgr::StopAndRemove(DrawBase::DRAW_TYPE draw_type)
         }
     }
 }
+void DrawMgr::UpdateParsers()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("DrawMgr::UpdateParsers", std::this_thread::get_id());
+#endif
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (auto it : _objects)
+        it->UpdateParsers();
+}
 
 void DrawMgr::SetGlobalSpec(const std::string& key, const std::string& value)
 {
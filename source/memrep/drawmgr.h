@@ -30,6 +30,8 @@ class DrawMgr : public QObject
         void Start(DrawBase::DRAW_TYPE draw_type, int iter_max = -1);
         void Stop();
         void StopAndRemove(DrawBase::DRAW_TYPE draw_type);
+        void UpdateParsers();
+            //Brings each object's parsers up to date with the models
 
         void SetGlobalSpec(const std::string& key, const std::string& value);
         void SetGlobalSpec(const std::string& key, int value);
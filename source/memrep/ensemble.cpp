@@ -0,0 +1,215 @@
+#include "ensemble.h"
+
+const size_t Ensemble::DIRECT_IO_SIZE = 128 * 1024 * 1024;
+const size_t Ensemble::MAX_CHUNK_SIZE = 4 * 1024 * 1024;
+const size_t Ensemble::PROGRESS_STEPS = 1024;
+const unsigned int Ensemble::SEED = 1;
+
+Ensemble::Ensemble(const std::vector<int>& variants, size_t inits_per_variant,
+                   size_t num_steps, int save_mod_n)
+    : _cancel(false), _initsPerVariant(std::max(inits_per_variant, (size_t)1)),
+      _log(Log::Instance()), _modelMgr(ModelMgr::Instance()),
+      _numDiffs(_modelMgr->Model(ds::DIFF)->NumPars()),
+      _numPars(_modelMgr->Model(ds::INP)->NumPars()),
+      _numRuns(std::max(variants.size(), (size_t)1) * _initsPerVariant),
+      _numSamples((num_steps + std::max(save_mod_n, 1) - 1) / std::max(save_mod_n, 1)),
+      _numSteps(num_steps),
+      _saveModN(std::max(save_mod_n, 1)), _stepsDone(0), _variants(variants)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("Ensemble::Ensemble", std::this_thread::get_id());
+#endif
+    _fields = _modelMgr->Model(ds::DIFF)->ShortKeys();
+    const VecStr vars = _modelMgr->Model(ds::VAR)->ShortKeys();
+    _fields.insert(_fields.end(), vars.cbegin(), vars.cend());
+}
+
+void Ensemble::Run(const std::string& file_name)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("Ensemble::Run", std::this_thread::get_id());
+#endif
+    WorkerPool* pool = WorkerPool::Instance();
+    try
+    {
+        //The current parameters and initial conditions are whatever a freshly initialized
+        //ParserMgr starts from.  Each slot gets a copy, so only one parses the model.
+        ParserMgr base;
+        base.InitializeFull();
+        MakePars( base.ConstData(ds::INP) );
+        MakeInits( base.ConstData(ds::DIFF) );
+        std::vector<ParserMgr> parser_mgrs(pool->NumSlots(), base);
+        std::vector< std::vector<double> > results(pool->NumSlots());
+        _stepsDone = 0;
+
+        VecStr fields(1, "run");
+        fields.insert(fields.end(), _fields.cbegin(), _fields.cend());
+        DatFileOut out(file_name, _numRuns*NumCols()*_numSamples > DIRECT_IO_SIZE);
+        out.Open(fields, _saveModN);
+        std::mutex out_mutex;
+        std::condition_variable out_turn;
+        size_t next_chunk = 0;
+
+        const size_t run_size = std::max(NumCols()*_numSamples, (size_t)1),
+                chunk_size = std::max( (size_t)1, std::min(
+                    (_numRuns + pool->NumSlots() - 1) / pool->NumSlots(),
+                    MAX_CHUNK_SIZE / run_size) ),
+                num_chunks = (_numRuns + chunk_size - 1) / chunk_size;
+        pool->Run(num_chunks, [&](size_t chunk, size_t slot)
+        {
+            const size_t first_run = chunk*chunk_size,
+                    num_runs = std::min(chunk_size, _numRuns - first_run);
+            std::exception_ptr except;
+            try
+            {
+                RunChunk(parser_mgrs[slot], results[slot], first_run, num_runs);
+            }
+            catch (...)
+            {
+                except = std::current_exception();
+            }
+
+            //Chunks are claimed in order, so every earlier one is already running and the wait
+            //is short; a chunk that fails still takes its turn, so later ones aren't stranded
+            std::unique_lock<std::mutex> lock(out_mutex);
+            out_turn.wait(lock, [&]() { return next_chunk==chunk; });
+            try
+            {
+                if (!except && !_cancel)
+                    WriteChunk(out, results[slot], first_run, num_runs);
+            }
+            catch (...)
+            {
+                except = std::current_exception();
+            }
+            if (except) _cancel = true; //What's written so far stays a prefix of the runs
+            ++next_chunk;
+            out_turn.notify_all();
+            lock.unlock();
+            if (except) std::rethrow_exception(except);
+        });
+        out.Close();
+    }
+    catch (std::exception& e)
+    {
+        _log->AddExcept("Ensemble::Run: " + std::string(e.what()));
+        throw (e);
+    }
+}
+
+int Ensemble::Variant(size_t run) const
+{
+    return _variants.empty() ? -1 : _variants.at(run / _initsPerVariant);
+}
+
+void Ensemble::MakeInits(const double* current)
+{
+    _inits.resize(_numRuns*_numDiffs);
+    std::mt19937 gen(SEED); //Fixed, so an ensemble can be rerun exactly
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    for (size_t r=0; r<_numRuns; ++r)
+        for (size_t k=0; k<_numDiffs; ++k)
+        {
+            const double min = _modelMgr->Minimum(ds::INIT, k),
+                    max = _modelMgr->Maximum(ds::INIT, k);
+            _inits[r*_numDiffs + k] = (_initsPerVariant==1)
+                    ? current[k]
+                    : min + unif(gen)*(max - min);
+        }
+}
+void Ensemble::MakePars(const double* current)
+{
+    _pars.resize(_numRuns*_numPars);
+    const ParamModelBase* inputs = _modelMgr->Model(ds::INP);
+    for (size_t r=0; r<_numRuns; ++r)
+    {
+        double* pars = &_pars[r*_numPars];
+        std::copy(current, current+_numPars, pars);
+        const int variant = Variant(r);
+        if (variant==-1) continue;
+
+        const ModelMgr::ParVariant* pv = _modelMgr->GetParVariant(variant);
+        for (const auto& it : pv->pars)
+        {
+            const int idx = inputs->KeyIndex(it.first);
+            const bool do_warn = r % _initsPerVariant == 0; //Once per variant
+            if (idx==-1)
+            {
+                if (do_warn)
+                    _log->AddMesg("Warning: parameter " + it.first + " in variant "
+                                  + pv->title + " does not exist, not used.");
+                continue;
+            }
+            if (_modelMgr->IsFreeze(ds::INP, idx))
+            {
+                if (do_warn)
+                    _log->AddMesg("Warning: parameter " + it.first + " in variant "
+                                  + pv->title + " is frozen, not used.");
+                    //Frozen inputs are folded into the compiled program as constants
+                continue;
+            }
+            pars[idx] = std::stod(it.second);
+        }
+    }
+}
+void Ensemble::RunChunk(ParserMgr& parser_mgr, std::vector<double>& results,
+                        size_t first_run, size_t num_runs)
+{
+    parser_mgr.BatchBegin(num_runs);
+    std::vector<double> lanes(num_runs);
+    for (size_t k=0; k<_numPars; ++k)
+    {
+        for (size_t r=0; r<num_runs; ++r)
+            lanes[r] = _pars[(first_run+r)*_numPars + k];
+        parser_mgr.SetBatchData(ds::INP, k, lanes.data());
+    }
+    for (size_t k=0; k<_numDiffs; ++k)
+    {
+        for (size_t r=0; r<num_runs; ++r)
+            lanes[r] = _inits[(first_run+r)*_numDiffs + k];
+        parser_mgr.SetBatchData(ds::DIFF, k, lanes.data());
+    }
+
+    const size_t num_cols = NumCols(),
+            total_steps = _numRuns*_numSteps;
+    results.resize(num_runs*num_cols*_numSamples);
+    for (size_t step=0; step<_numSteps && !_cancel; ++step)
+    {
+        if (step % _saveModN == 0)
+        {
+            const size_t s = step / _saveModN;
+            for (size_t c=0; c<num_cols; ++c)
+            {
+                const double* vals = (c<_numDiffs)
+                        ? parser_mgr.BatchData(ds::DIFF, c)
+                        : parser_mgr.BatchData(ds::VAR, c-_numDiffs);
+                for (size_t r=0; r<num_runs; ++r)
+                    results[(r*num_cols + c)*_numSamples + s] = vals[r];
+            }
+        }
+        parser_mgr.ParserEvalBatch();
+
+        if ((step+1) % PROGRESS_STEPS == 0 || step+1==_numSteps)
+        {
+            const size_t num_new = (step % PROGRESS_STEPS + 1) * num_runs;
+            const size_t done = (_stepsDone += num_new);
+            if (_progress) _progress( (double)done / (double)total_steps );
+        }
+    }
+}
+void Ensemble::WriteChunk(DatFileOut& out, const std::vector<double>& results,
+                          size_t first_run, size_t num_runs)
+{
+    const size_t num_cols = NumCols();
+    std::vector<double> record(num_cols+1);
+    for (size_t r=0; r<num_runs; ++r)
+    {
+        record[0] = (double)(first_run+r);
+        for (size_t s=0; s<_numSamples; ++s)
+        {
+            for (size_t c=0; c<num_cols; ++c)
+                record[c+1] = results[(r*num_cols + c)*_numSamples + s];
+            out.Write(record.data(), (int)record.size());
+        }
+    }
+}
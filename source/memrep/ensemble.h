@@ -0,0 +1,87 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <random>
+
+#include "modelmgr.h"
+#include "parsermgr.h"
+#include "../file/datfileout.h"
+#include "../globals/globals.h"
+#include "../globals/log.h"
+#include "../globals/scopetracker.h"
+#include "../globals/workerpool.h"
+
+//Simulates a set of parameter variants, each from one or more initial conditions, side by
+//side.  Runs are split into chunks, and each chunk is stepped as one batch by the ParserMgr of
+//the worker pool slot running it.
+//  Each slot collects its chunk's results in its own buffer, one column per differential and
+//variable holding every save_mod_n'th sample, and writes them out once every earlier chunk
+//has been written.  Chunks are capped in size, so memory doesn't grow with the number of runs
+//or steps.
+//  As in the vector field, non-user variables (input files and random numbers) are held at
+//their current values, and conditions aren't evaluated.
+class Ensemble
+{
+    public:
+        typedef std::function<void(double)> ProgressFunc; //Called with the fraction done
+
+        Ensemble(const std::vector<int>& variants, size_t inits_per_variant,
+                 size_t num_steps, int save_mod_n);
+            //An empty variants means just the current parameters.  With one initial condition
+            //per variant the current one is used, otherwise they're drawn uniformly from the
+            //INIT ranges.
+
+        void Cancel() { _cancel = true; }
+        void Run(const std::string& file_name);
+            //Blocks until every run is done and written, or the ensemble is cancelled.  The
+            //file has one record per sample:  the run number followed by Fields().  Runs are
+            //written in order; a cancelled ensemble keeps the runs written so far.
+        void SetProgressFunc(const ProgressFunc& func) { _progress = func; }
+
+        const VecStr& Fields() const { return _fields; }
+        const double* Init(size_t run) const { return &_inits.at(run*_numDiffs); }
+        bool IsCancelled() const { return _cancel; }
+        size_t NumCols() const { return _fields.size(); }
+        size_t NumRuns() const { return _numRuns; }
+        size_t NumSamples() const { return _numSamples; }
+        int Variant(size_t run) const; //-1 for the current parameters
+
+    private:
+        static const size_t DIRECT_IO_SIZE; //Results past this many doubles bypass the page cache
+        static const size_t MAX_CHUNK_SIZE; //Doubles of results per chunk
+        static const size_t PROGRESS_STEPS;
+        static const unsigned int SEED;
+
+#ifdef __GNUG__
+        Ensemble(const Ensemble&) = delete;
+        Ensemble& operator=(const Ensemble&) = delete;
+#endif
+
+        void MakeInits(const double* current);
+        void MakePars(const double* current);
+        void RunChunk(ParserMgr& parser_mgr, std::vector<double>& results,
+                      size_t first_run, size_t num_runs);
+            //results:  for each run of the chunk, NumCols() columns of _numSamples
+        void WriteChunk(DatFileOut& out, const std::vector<double>& results,
+                        size_t first_run, size_t num_runs);
+
+        std::atomic<bool> _cancel;
+        VecStr _fields;
+        std::vector<double> _inits; //_numDiffs per run
+        const size_t _initsPerVariant;
+        Log* const _log;
+        ModelMgr* const _modelMgr;
+        const size_t _numDiffs, _numPars, _numRuns, _numSamples, _numSteps;
+        std::vector<double> _pars; //_numPars per run
+        ProgressFunc _progress;
+        const int _saveModN;
+        std::atomic<size_t> _stepsDone; //Summed over runs
+        const std::vector<int> _variants;
+};
+
+#endif // ENSEMBLE_H
@@ -0,0 +1,341 @@
+#include "exprnschedule.h"
+
+const std::set<std::string> ExprnSchedule::PURE_FUNCS = {
+    "sin", "cos", "tan", "asin", "acos", "atan", "sinh", "cosh", "tanh", "asinh", "acosh",
+    "atanh", "log2", "log10", "log", "ln", "exp", "sqrt", "sign", "rint", "abs", "min", "max",
+    "sum", "avg"
+};
+
+std::string ExprnSchedule::ConstKey(size_t idx)
+{
+    return "__c" + std::to_string(idx);
+}
+VecStr ExprnSchedule::Identifiers(const std::string& exprn)
+{
+    VecStr names, funcs;
+    Scan(exprn, names, funcs);
+    return names;
+}
+
+ExprnSchedule::ExprnSchedule(const ModelMgr* model_mgr)
+    : ExprnSchedule(model_mgr, model_mgr->Model(ds::VAR)->ShortKeys())
+{
+}
+ExprnSchedule::ExprnSchedule(const ModelMgr* model_mgr, const VecStr& outputs)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("ExprnSchedule::ExprnSchedule", std::this_thread::get_id());
+#endif
+    const ParamModelBase* inputs = model_mgr->Model(ds::INP),
+            * vars = model_mgr->Model(ds::VAR);
+    for (size_t i=0; i<inputs->NumPars(); ++i)
+        _params.insert(inputs->ShortKey(i));
+
+    const size_t num_vars = vars->NumPars();
+    std::map<std::string, size_t> user_idx;
+    for (size_t i=0; i<num_vars; ++i)
+        if (!vars->IsFreeze(i) && Input::Type(vars->Value(i))==Input::USER)
+            user_idx[vars->ShortKey(i)] = i;
+    auto users = [&](const std::string& exprn)
+    {
+        Group idxs;
+        for (const auto& it : Identifiers(exprn))
+        {
+            auto itu = user_idx.find(it);
+            if (itu!=user_idx.end()) idxs.push_back(itu->second);
+        }
+        return idxs;
+    };
+    _deps.resize(num_vars);
+    for (const auto& it : user_idx)
+        _deps[it.second] = users(vars->Value(it.second));
+
+    for (size_t i=0; i<num_vars; ++i)
+        if (vars->IsFreeze(i)) _varLiterals[vars->ShortKey(i)] = "0";
+    _literals = _varLiterals;
+    for (size_t i=0; i<inputs->NumPars(); ++i)
+        if (inputs->IsFreeze(i)) _literals[inputs->ShortKey(i)] = "(" + inputs->Value(i) + ")";
+    const ParamModelBase* diffs = model_mgr->Model(ds::DIFF),
+            * inits = model_mgr->Model(ds::INIT);
+    if (!model_mgr->HasSolver())
+        for (size_t i=0; i<diffs->NumPars(); ++i)
+            if (diffs->IsFreeze(i)) _literals[diffs->ShortKey(i)] = "(" + inits->Value(i) + ")";
+                //A solver leaves frozen differentials where they are, which needn't be there
+
+    //Whatever the differentials, conditions, nullclines, Jacobian and outputs use, directly
+    //or through other variables, is live
+    Group roots;
+    const ds::PMODEL models[] = {ds::DIFF, ds::NC, ds::JAC};
+    for (auto mi : models)
+    {
+        const ParamModelBase* model = model_mgr->Model(mi);
+        for (size_t i=0; i<model->NumPars(); ++i)
+        {
+            if (model->IsFreeze(i)) continue;
+            const Group idxs = users(model->Value(i));
+            roots.insert(roots.end(), idxs.cbegin(), idxs.cend());
+        }
+    }
+    const size_t num_conds = model_mgr->Model(ds::COND)->NumPars();
+    for (size_t k=0; k<num_conds; ++k)
+    {
+        VecStr exprns = model_mgr->CondResults(k);
+        exprns.push_back(model_mgr->Model(ds::COND)->Key(k));
+        for (const auto& it : exprns)
+        {
+            const Group idxs = users(it);
+            roots.insert(roots.end(), idxs.cbegin(), idxs.cend());
+        }
+    }
+    for (const auto& it : outputs)
+    {
+        auto itu = user_idx.find(it);
+        if (itu!=user_idx.end()) roots.push_back(itu->second);
+    }
+
+    _isLive.assign(num_vars, false);
+    while (!roots.empty())
+    {
+        const size_t v = roots.back();
+        roots.pop_back();
+        if (_isLive[v]) continue;
+        _isLive[v] = true;
+        roots.insert(roots.end(), _deps[v].cbegin(), _deps[v].cend());
+    }
+
+    std::vector<int> index(num_vars, -1), low(num_vars, 0);
+    std::vector<size_t> stack;
+    std::vector<bool> on_stack(num_vars, false);
+    int ct = 0;
+    for (size_t v=0; v<num_vars; ++v)
+        if (_isLive[v] && index[v]==-1)
+            Connect(v, index, low, stack, on_stack, ct);
+}
+
+std::string ExprnSchedule::Hoist(const std::string& exprn, VecStr& consts) const
+{
+    if (_params.empty()) return exprn;
+    auto replace = [&](const std::string& sub)
+    {
+        auto it = std::find(consts.cbegin(), consts.cend(), sub);
+        const size_t idx = it - consts.cbegin();
+        if (it==consts.cend()) consts.push_back(sub);
+        return ConstKey(idx);
+    };
+
+    std::string out;
+    const size_t len = exprn.size();
+    size_t i = 0;
+    while (i<len)
+    {
+        const char c = exprn.at(i);
+        if (std::isalpha(c) || c=='_')
+        {
+            size_t end = i;
+            while (end<len && (std::isalnum(exprn.at(end)) || exprn.at(end)=='_')) ++end;
+            size_t open = end;
+            while (open<len && std::isspace(exprn.at(open))) ++open;
+            if (open<len && exprn.at(open)=='(' && PURE_FUNCS.count(exprn.substr(i, end-i)))
+            {
+                const size_t close = CloseParen(exprn, open);
+                if (close!=std::string::npos && IsConst(exprn.substr(i, close-i+1)))
+                {
+                    out += replace(exprn.substr(i, close-i+1));
+                    i = close+1;
+                    continue;
+                }
+            }
+            out += exprn.substr(i, end-i);
+            i = end;
+        }
+        else if (std::isdigit(c) || c=='.')
+        {
+            const size_t end = NumberEnd(exprn, i);
+            out += exprn.substr(i, end-i);
+            i = end;
+        }
+        else if (c=='(')
+        {
+            const size_t close = CloseParen(exprn, i);
+            if (close!=std::string::npos && IsConst(exprn.substr(i, close-i+1)))
+            {
+                out += "(" + replace(exprn.substr(i, close-i+1)) + ")";
+                    //Parenthesized still, in case it's a function's argument
+                i = close+1;
+            }
+            else
+            {
+                out += c;
+                ++i;
+            }
+        }
+        else
+        {
+            out += c;
+            ++i;
+        }
+    }
+    return out;
+}
+
+std::string ExprnSchedule::Specialize(const std::string& exprn, bool values_fixed,
+                                      std::set<std::string>* folded) const
+{
+    return Specialize(exprn, values_fixed, folded, 0);
+}
+
+size_t ExprnSchedule::CloseParen(const std::string& exprn, size_t open)
+{
+    int paren = 0;
+    for (size_t i=open; i<exprn.size(); ++i)
+    {
+        if (exprn.at(i)=='(') ++paren;
+        else if (exprn.at(i)==')' && --paren==0) return i;
+    }
+    return std::string::npos;
+}
+size_t ExprnSchedule::NumberEnd(const std::string& exprn, size_t pos)
+{
+    const size_t len = exprn.size();
+    while (pos<len && (std::isdigit(exprn.at(pos)) || exprn.at(pos)=='.')) ++pos;
+    if (pos<len && (exprn.at(pos)=='e' || exprn.at(pos)=='E'))
+    {
+        size_t exp = pos+1;
+        if (exp<len && (exprn.at(exp)=='+' || exprn.at(exp)=='-')) ++exp;
+        if (exp<len && std::isdigit(exprn.at(exp)))
+        {
+            pos = exp;
+            while (pos<len && std::isdigit(exprn.at(pos))) ++pos;
+        }
+    }
+    return pos;
+}
+void ExprnSchedule::Scan(const std::string& exprn, VecStr& names, VecStr& funcs)
+{
+    const size_t len = exprn.size();
+    size_t i = 0;
+    while (i<len)
+    {
+        const char c = exprn.at(i);
+        if (std::isalpha(c) || c=='_')
+        {
+            size_t end = i;
+            while (end<len && (std::isalnum(exprn.at(end)) || exprn.at(end)=='_')) ++end;
+            size_t next = end;
+            while (next<len && std::isspace(exprn.at(next))) ++next;
+            if (next<len && exprn.at(next)=='(')
+                funcs.push_back(exprn.substr(i, end-i));
+            else
+                names.push_back(exprn.substr(i, end-i));
+            i = end;
+        }
+        else if (std::isdigit(c) || c=='.')
+            i = NumberEnd(exprn, i);
+        else
+            ++i;
+    }
+}
+
+void ExprnSchedule::Connect(size_t v, std::vector<int>& index, std::vector<int>& low,
+                            std::vector<size_t>& stack, std::vector<bool>& on_stack, int& ct)
+{
+    index[v] = low[v] = ct++;
+    stack.push_back(v);
+    on_stack[v] = true;
+    for (auto w : _deps.at(v))
+    {
+        if (index[w]==-1)
+        {
+            Connect(w, index, low, stack, on_stack, ct);
+            low[v] = std::min(low[v], low[w]);
+        }
+        else if (on_stack[w])
+            low[v] = std::min(low[v], index[w]);
+    }
+    if (low[v]!=index[v]) return;
+
+    Group group;
+    size_t w;
+    do
+    {
+        w = stack.back();
+        stack.pop_back();
+        on_stack[w] = false;
+        group.push_back(w);
+    } while (w!=v);
+    std::sort(group.begin(), group.end()); //Model order, within a cycle
+    _varGroups.push_back(group);
+}
+bool ExprnSchedule::IsConst(const std::string& exprn) const
+{
+    //exprn is a parenthesized group or a function call.  A comma at the top level of a group
+    //means it's the argument list of a function, and an assignment has to happen every step.
+    const bool is_group = exprn.at(0)=='(';
+    std::string stripped;
+    int paren = 0;
+    for (size_t i=0; i<exprn.size(); ++i)
+    {
+        const char c = exprn.at(i);
+        if (!std::isspace(c) && c!='(' && c!=')') stripped += c;
+        if (c=='(') ++paren;
+        else if (c==')') --paren;
+        else if (c==',' && paren==1 && is_group) return false;
+        else if (c=='=' && (i==0 || !std::strchr("<>!=", exprn.at(i-1)))
+                 && (i+1==exprn.size() || exprn.at(i+1)!='=')) return false;
+    }
+
+    VecStr names, funcs;
+    Scan(exprn, names, funcs);
+    if (names.empty()) return false; //Numbers alone, which muParser folds itself
+    if (funcs.empty() && stripped==names.front()) return false; //Nothing to save
+    for (const auto& it : names)
+        if (!_params.count(it)) return false;
+    for (const auto& it : funcs)
+        if (!PURE_FUNCS.count(it)) return false;
+    return true;
+}
+std::string ExprnSchedule::Specialize(const std::string& exprn, bool values_fixed,
+                                      std::set<std::string>* folded, size_t depth) const
+{
+    const std::map<std::string, std::string>& literals = values_fixed ? _literals : _varLiterals;
+    if (literals.empty()) return exprn;
+    if (depth>literals.size())
+        throw std::runtime_error("ExprnSchedule::Specialize: Frozen values refer to each other");
+
+    std::string out;
+    const size_t len = exprn.size();
+    size_t i = 0;
+    while (i<len)
+    {
+        const char c = exprn.at(i);
+        if (std::isalpha(c) || c=='_')
+        {
+            size_t end = i;
+            while (end<len && (std::isalnum(exprn.at(end)) || exprn.at(end)=='_')) ++end;
+            size_t next = end;
+            while (next<len && std::isspace(exprn.at(next))) ++next;
+            const std::string name = exprn.substr(i, end-i);
+            auto it = literals.find(name);
+            if (it!=literals.end() && (next==len || exprn.at(next)!='('))
+            {
+                out += Specialize(it->second, values_fixed, folded, depth+1);
+                if (folded) folded->insert(name);
+            }
+            else
+                out += name;
+            i = end;
+        }
+        else if (std::isdigit(c) || c=='.')
+        {
+            const size_t end = NumberEnd(exprn, i);
+            out += exprn.substr(i, end-i);
+            i = end;
+        }
+        else
+        {
+            out += c;
+            ++i;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,71 @@
+#ifndef EXPRNSCHEDULE_H
+#define EXPRNSCHEDULE_H
+
+#include <cctype>
+#include <cstring>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include "input.h"
+#include "modelmgr.h"
+
+//The order of the variables within a step.  Each variable is computed after the variables
+//its expression uses, so it sees their values from the same step, and variables nothing
+//needs--no differential, condition, nullcline or Jacobian entry, nor an output--are left out.
+//Variables that use each other in a cycle form one group, whose members see each other's
+//values from the last step.
+//  Only user variables are scheduled:  inputs and frozen variables depend on nothing.  What is
+//frozen can also be specialized, i.e. folded into the expressions as literals.
+class ExprnSchedule
+{
+    public:
+        typedef std::vector<size_t> Group;
+
+        static std::string ConstKey(size_t idx); //The parser variable of a hoisted constant
+        static VecStr Identifiers(const std::string& exprn); //Not including function names
+
+        ExprnSchedule() {}
+        explicit ExprnSchedule(const ModelMgr* model_mgr); //Every variable is an output
+        ExprnSchedule(const ModelMgr* model_mgr, const VecStr& outputs);
+            //outputs:  the variables read from outside the model, e.g. to be plotted
+
+        std::string Hoist(const std::string& exprn, VecStr& consts) const;
+            //Replaces each largest parenthesized subexpression, or pure function call, that
+            //uses only input parameters with ConstKey, and its expression appended to consts
+        bool IsLive(size_t var_idx) const { return _isLive.at(var_idx); }
+        std::string Specialize(const std::string& exprn, bool values_fixed,
+                               std::set<std::string>* folded = nullptr) const;
+            //Replaces frozen variables with their value, 0.  With values_fixed, also frozen
+            //parameters, and under Euler frozen differentials, which are reset to their
+            //initial condition each step.  Generated programs take parameters and initial
+            //conditions as arguments, so aren't values_fixed.
+            //  folded:  gets the keys replaced, so their changes can be respecialized
+        const std::vector<Group>& VarGroups() const { return _varGroups; }
+            //In evaluation order.  Compute every member of a group, then copy them all back.
+
+    private:
+        static const std::set<std::string> PURE_FUNCS; //Built-ins safe to evaluate once
+
+        static size_t CloseParen(const std::string& exprn, size_t open);
+        static size_t NumberEnd(const std::string& exprn, size_t pos);
+        static void Scan(const std::string& exprn, VecStr& names, VecStr& funcs);
+            //Names followed by an opening parenthesis are functions
+
+        void Connect(size_t v, std::vector<int>& index, std::vector<int>& low,
+                     std::vector<size_t>& stack, std::vector<bool>& on_stack, int& ct);
+            //Tarjan's strongly connected components, which come out dependencies first
+        bool IsConst(const std::string& exprn) const;
+        std::string Specialize(const std::string& exprn, bool values_fixed,
+                               std::set<std::string>* folded, size_t depth) const;
+            //depth:  of literals within literals, i.e. parameters in initial conditions
+
+        std::vector<Group> _deps; //The user variables each user variable uses
+        std::vector<bool> _isLive;
+        std::map<std::string, std::string> _literals, _varLiterals;
+            //Frozen keys and their values; _varLiterals is just the variables
+        std::set<std::string> _params;
+        std::vector<Group> _varGroups;
+};
+
+#endif // EXPRNSCHEDULE_H
@@ -2,12 +2,33 @@
 
 const size_t Input::INPUT_EXP = 20;
 const size_t Input::INPUT_SIZE = 16 * 1024 * 1024;
-const size_t Input::INPUT_MASK = INPUT_SIZE-1;
 const std::string Input::INPUT_FILE_STR = "input file";
 const std::string Input::GAMMA_RAND_STR = "gamma rand";
 const std::string Input::NORM_RAND_STR = "normal rand";
 const std::string Input::UNI_RAND_STR = "uniform rand";
+const std::string Input::LOOP_STR = "loop";
+const std::string Input::HOLD_STR = "hold";
+const std::string Input::FAIL_STR = "error";
 
+bool Input::IsRandom(TYPE type)
+{
+    return type==GAMMA_RAND || type==NORM_RAND || type==UNI_RAND;
+}
+RandSource::DIST Input::RandDist(TYPE type)
+{
+    switch (type)
+    {
+        case UNI_RAND:
+            return RandSource::UNIFORM;
+        case GAMMA_RAND:
+            return RandSource::EXPONENTIAL; //The default gamma distribution, shape and scale 1
+        case NORM_RAND:
+            return RandSource::NORMAL;
+        default:
+            throw std::runtime_error("Input::RandDist: Not a random input type, "
+                                     + std::to_string(type));
+    }
+}
 Input::TYPE Input::Type(const std::string& text)
 {
     if (text.empty()) return USER;
@@ -22,9 +43,23 @@ Input::TYPE Input::Type(const std::string& text)
 
     return USER;
 }
+Input::END_POLICY Input::EndPolicy(const std::string& text)
+{
+    const size_t pos = text.find_last_of('"');
+    std::string policy = (pos==std::string::npos) ? text : text.substr(pos+1);
+    policy.erase(std::remove_if(policy.begin(), policy.end(), ::isspace), policy.end());
+    if (policy.empty() || policy==LOOP_STR)
+        return LOOP;
+    if (policy==HOLD_STR)
+        return HOLD;
+    if (policy==FAIL_STR)
+        return FAIL;
+
+    throw std::runtime_error("Input::EndPolicy: Unknown end of input policy, " + policy);
+}
 
 Input::Input(double* value, int index)
-    : _ct(0), _index(index), _input(nullptr), _log(Log::Instance()),
+    : _ct(0), _endPolicy(LOOP), _index(index), _log(Log::Instance()),
       _samplesPerUnitTime(-1), _type(UNKNOWN)
 {
 #ifdef DEBUG_FUNC
@@ -33,13 +68,13 @@ Input::Input(double* value, int index)
     _listeners.push_back(value);
 }
 Input::Input(const Input& other)
-    : _ct(other._ct), _index(other._index), _input(nullptr), _log(Log::Instance()),
-      _samplesPerUnitTime(other._samplesPerUnitTime), _type(other._type), _listeners(other._listeners)
+    : _ct(other._ct), _endPolicy(other._endPolicy), _index(other._index), _log(Log::Instance()),
+      _samplesPerUnitTime(other._samplesPerUnitTime), _source(other._source),
+      _type(other._type), _listeners(other._listeners)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("Input::Input(const Input& other)", std::this_thread::get_id());
 #endif
-    DeepCopy(other);
 }
 
 Input::~Input()
@@ -47,54 +82,30 @@ Input::~Input()
 #ifdef DEBUG_FUNC
     ScopeTracker st("Input::~Input", std::this_thread::get_id());
 #endif
-    if (_input) delete[] _input;
 }
 
 void Input::AddListener(double* listener)
 {
     _listeners.push_back(listener);
 }
-void Input::GenerateInput(TYPE type)
+void Input::GenerateInput(TYPE type, uint32_t seed)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("Input::GenerateInput", std::this_thread::get_id());
 #endif
 //    std::lock_guard<std::mutex> lock(_mutex);
     ResetInput();
-    _input = new double[INPUT_SIZE];
-
-    switch (type)
-    {
-        case UNKNOWN:
-            throw std::runtime_error("Input::GenerateInput: Unknown Variable Type");
-        case UNI_RAND:
-        {
-            std::uniform_real_distribution<double> uni_rand;
-            GenerateRandInput(uni_rand);
-            break;
-        }
-        case GAMMA_RAND:
-        {
-            std::gamma_distribution<double> gamma_rand;
-            GenerateRandInput(gamma_rand);
-            break;
-        }
-        case NORM_RAND:
-        {
-            std::normal_distribution<double> norm_rand;
-            GenerateRandInput(norm_rand);
-            break;
-        }
-        case INPUT_FILE:
-        case USER:
-            throw std::runtime_error("Input::GenerateInput: type not defined for string " + std::to_string(type));
-    }
+    if (type==UNKNOWN)
+        throw std::runtime_error("Input::GenerateInput: Unknown Variable Type");
+    if (!IsRandom(type))
+        throw std::runtime_error("Input::GenerateInput: type not defined for string " + std::to_string(type));
 
+    _source = std::make_shared<RandSource>(RandDist(type), seed, (uint32_t)_index);
     _samplesPerUnitTime = 1;
     _type = type;
     UpdateListeners();
 }
-void Input::LoadInput(const std::string& file_name)
+void Input::LoadInput(const std::string& file_name, END_POLICY end_policy)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("Input::LoadInput", std::this_thread::get_id());
@@ -104,13 +115,17 @@ void Input::LoadInput(const std::string& file_name)
     {
         std::string fn = ExpandFileName(file_name);
         std::string suffix = fn.substr(fn.find_last_of('.')+1);
+        const bool wrap = end_policy==LOOP;
         if (suffix=="txt")
-            LoadTextInput(fn);
+            _source = std::make_shared<TextSource>(fn, wrap);
         else if (suffix=="dsin")
-            LoadBinInput(fn);
+            _source = std::make_shared<MappedSource>(fn, wrap);
         else
             throw std::runtime_error("Input::LoadInput: Bad file extension.");
+        _log->AddMesg(std::to_string(_source->Length()) + " samples in " + fn);
 
+        _endPolicy = end_policy;
+        _samplesPerUnitTime = _source->SamplesPerUnitTime();
         _type = INPUT_FILE;
         UpdateListeners();
     }
@@ -122,15 +137,21 @@ void Input::LoadInput(const std::string& file_name)
 }
 void Input::NextInput(int n)
 {
-    if (!_input)
-        throw std::runtime_error("Input::NextInput: _input is null");
+    if (!_source)
+        throw std::runtime_error("Input::NextInput: No input loaded");
     _ct+=n;
-    _ct &= INPUT_MASK;
+    if (_ct>=_source->Length())
+    {
+        if (_endPolicy==FAIL)
+            throw std::runtime_error("Input::NextInput: Input " + std::to_string(_index)
+                                     + " ran out of samples");
+        _ct = Clamp(_ct);
+    }
     UpdateListeners();
 }
 double Input::NextInputHalf() const
 {
-    return (_input[_ct] + SeeNextInput()) / 2.0;
+    return (_source->Sample(_ct) + SeeNextInput()) / 2.0;
 }
 void Input::RemoveListener(double* listener)
 {
@@ -139,24 +160,30 @@ void Input::RemoveListener(double* listener)
 }
 double Input::SeeNextInput() const
 {
-    return _input[_ct+1];
+    return _source->Sample( Clamp(_ct+1) );
 }
 void Input::SeekTo(int ct)
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("Input::SeekTo", std::this_thread::get_id());
 #endif
-    _ct = ct;
+    if (!_source)
+    {
+        _ct = 0;
+        return;
+    }
+    if ((size_t)ct>=_source->Length() && _endPolicy==FAIL)
+        throw std::runtime_error("Input::SeekTo: Input " + std::to_string(_index)
+                                 + " has no sample " + std::to_string(ct));
+    _ct = Clamp(ct);
+    UpdateListeners();
 }
 
-void Input::DeepCopy(const Input& other)
+size_t Input::Clamp(size_t k) const
 {
-#ifdef DEBUG_FUNC
-    ScopeTracker st("Input::DeepCopy", std::this_thread::get_id());
-#endif
-    if (!other._input) return;
-    _input = new double[INPUT_SIZE];
-    memcpy(_input,  other._input, INPUT_SIZE*sizeof(_input[0]));
+    const size_t length = _source->Length();
+    if (k<length) return k;
+    return (_endPolicy==LOOP) ? k % length : length-1;
 }
 std::string Input::ExpandFileName(const std::string& file_name) const
 {
@@ -169,88 +196,20 @@ std::string Input::ExpandFileName(const std::string& file_name) const
         out.replace(pos, 5, DDM::InputFilesDir());
     return out;
 }
-template<typename T>
-void Input::GenerateRandInput(T& distribution)
-{
-#ifdef DEBUG_FUNC
-    ScopeTracker st("Input::GenerateRandInput", std::this_thread::get_id());
-#endif
-    if (!_input)
-        throw std::runtime_error("Input::GenerateRandInput: _input is null");
-    std::mt19937_64 mte;
-    for (int k=0; k<INPUT_SIZE; ++k)
-        _input[k] = distribution(mte);
-}
-void Input::LoadBinInput(const std::string& file_name)
-{
-#ifdef DEBUG_FUNC
-    ScopeTracker st("Input::LoadBinInput", std::this_thread::get_id());
-#endif
-    FILE* fp = fopen(file_name.c_str(), "rb");
-    if (!fp) throw std::runtime_error("Input::LoadBinInput: File "
-                                                  + file_name + " failed to open.");
-
-    int vnum;
-    size_t br = fread(&vnum, sizeof(int), 1, fp);
-
-    br = fread(&_samplesPerUnitTime, sizeof(int), 1, fp);
-
-    int num_elts;
-    br = fread(&num_elts, sizeof(int), 1, fp);
-
-    _input = new double[INPUT_SIZE];
-    br = fread(_input, sizeof(double), std::min((int)INPUT_SIZE, num_elts), fp);
-    _log->AddMesg(std::to_string(br) + " elements read from " + file_name);
-}
-void Input::LoadTextInput(const std::string& file_name)
-{
-#ifdef DEBUG_FUNC
-    ScopeTracker st("Input::LoadTextInput", std::this_thread::get_id());
-#endif
-    std::ifstream file;
-    file.open(file_name);
-    if (!file.is_open()) throw std::runtime_error("Input::LoadTextInput: File "
-                                                  + file_name + " failed to open.");
-
-    std::string vstr;
-    std::getline(file, vstr);
-
-    std::string line;
-    std::getline(file, line);
-    _samplesPerUnitTime = std::stoi(line);
-
-    std::getline(file, line);
-    const int num_elts = std::stoi(line);
-
-    _input = new double[INPUT_SIZE];
-    size_t input_ct = 0;
-    for (int i=0; i<num_elts; ++i)
-    {
-        std::getline(file, line);
-        _input[input_ct++] = std::stof(line);
-    }
-    while (input_ct<INPUT_SIZE)
-    {
-        _input[input_ct] = _input[input_ct%num_elts];
-        ++input_ct;
-    }
-}
 void Input::ResetInput()
 {
 #ifdef DEBUG_FUNC
     ScopeTracker st("Input::ResetInput", std::this_thread::get_id());
 #endif
     _ct = 0;
-    if (_input)
-    {
-        delete[] _input;
-        _input = nullptr;
-    }
+    _endPolicy = LOOP;
+    _source.reset();
     _type = UNKNOWN;
 }
 
 void Input::UpdateListeners()
 {
+    const double val = _source->Sample(_ct);
     for (auto it : _listeners)
-        *it = _input[_ct];
+        *it = val;
 }
@@ -9,16 +9,20 @@
 #include <random>
 #include <string>
 
+#include "mappedsource.h"
+#include "randsource.h"
+#include "textsource.h"
 #include "../file/defaultdirmgr.h"
 #include "../globals/log.h"
 #include "../globals/scopetracker.h"
 
+//An input file is given as "file_name", optionally followed by what to do once its samples
+//run out:  loop (the default), hold the last sample, or error.
 class Input
 {
     public:
         static const size_t INPUT_EXP,
-                            INPUT_SIZE,
-                            INPUT_MASK;
+                            INPUT_SIZE;
 
         enum TYPE
         {
@@ -29,19 +33,34 @@ class Input
             UNI_RAND,
             USER
         };
+        static bool IsRandom(TYPE type);
+        static RandSource::DIST RandDist(TYPE type);
         static TYPE Type(const std::string& text);
         static const std::string INPUT_FILE_STR,
                                 GAMMA_RAND_STR,
                                 NORM_RAND_STR,
                                 UNI_RAND_STR;
 
+        enum END_POLICY
+        {
+            LOOP,
+            HOLD,
+            FAIL
+        };
+        static END_POLICY EndPolicy(const std::string& text);
+            //From whatever follows the file name's closing quote
+        static const std::string LOOP_STR,
+                                HOLD_STR,
+                                FAIL_STR;
+
         explicit Input(double* value, int idx);
         Input(const Input& other);
         ~Input();
 
         void AddListener(double* listener);
-        void GenerateInput(TYPE type);
-        void LoadInput(const std::string& file_name);
+        void GenerateInput(TYPE type, uint32_t seed);
+            //The input's index picks its stream, so inputs with the same seed are independent
+        void LoadInput(const std::string& file_name, END_POLICY end_policy = LOOP);
         void NextInput(int n = 1);
         double NextInputHalf() const;
         void RemoveListener(double* listener);
@@ -57,20 +76,17 @@ class Input
         Input& operator=(const Input&) = delete;
 #endif
 
-        void DeepCopy(const Input& other);
+        size_t Clamp(size_t k) const; //Applies the end policy, without ever throwing
         std::string ExpandFileName(const std::string& file_name) const;
-        template<typename T>
-        void GenerateRandInput(T& distribution);
-        void LoadBinInput(const std::string& file_name);
-        void LoadTextInput(const std::string& file_name);
         void ResetInput();
         void UpdateListeners();
 
         size_t _ct;
+        END_POLICY _endPolicy;
         const int _index;
-        double* _input;
         Log* const _log;
         int _samplesPerUnitTime;
+        std::shared_ptr<InputSource> _source; //Shared by copies
         TYPE _type;
         std::vector<double*> _listeners;
 };
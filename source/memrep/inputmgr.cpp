@@ -1,6 +1,7 @@
 #include "inputmgr.h"
 
 InputMgr* InputMgr::_instance = nullptr;
+const uint32_t InputMgr::DEFAULT_SEED = 1;
 
 InputMgr* InputMgr::Instance()
 {
@@ -28,22 +29,16 @@ int InputMgr::AssignInput(double* listener, const std::string& type_str, int idx
         {
             input_idx = EmplaceInput(listener, idx);
             if (input_idx != -1)
-                _inputs[input_idx].GenerateInput(type);
+                _inputs[input_idx].GenerateInput(type, _seed);
             break;
         }
         case Input::INPUT_FILE:
         {
             input_idx = EmplaceInput(listener, idx);
-            std::string file_name = type_str;
-            file_name.erase(
-                std::remove_if(file_name.begin(), file_name.end(), [&](std::string::value_type c)
-                {
-                    return c=='"';
-                }),
-                    file_name.end());
+            const std::string file_name = ds::StripQuotes(type_str);
             if (input_idx != -1)
             {
-                _inputs[input_idx].LoadInput(file_name);
+                _inputs[input_idx].LoadInput(file_name, Input::EndPolicy(type_str));
                 _stepCts[input_idx] = 0;
             }
             break;
@@ -74,11 +69,17 @@ void InputMgr::InputEval()
 }
 void InputMgr::JumpToSample(int n)
 {
+    //n is a time.  Inputs are seeked to their sample at that time, and the step counts are
+    //set so that the following samples come on the same steps as in a run from 0, which is
+    //also what compiled models do.
     const size_t num_inputs = _inputs.size();
+    const int step_ct = (int)( (double)n / _modelMgr->ModelStep() + 0.5 );
     for (size_t i=0; i<num_inputs; ++i)
     {
-        const int ct = (int)( (double)n / (_modelMgr->ModelStep()) + 0.5 );
-        _inputs[i].SeekTo(ct);
+        const int steps_per_samp
+                = (int)(1.0 / (_modelMgr->ModelStep()*_inputs[i].SamplesPerUnitTime()) + 0.5);
+        _inputs[i].SeekTo( step_ct / std::max(steps_per_samp, 1) );
+        _stepCts[i] = step_ct;
     }
 }
 void InputMgr::RemoveListener(int idx, double* listener)
@@ -98,7 +99,7 @@ Input::TYPE InputMgr::Type(size_t i) const
 //    return _inputs.at(i).Value();
 //}
 
-InputMgr::InputMgr() : _modelMgr(ModelMgr::Instance())
+InputMgr::InputMgr() : _modelMgr(ModelMgr::Instance()), _seed(DEFAULT_SEED)
 {
 }
 
@@ -20,8 +20,10 @@ class InputMgr
             //To be called on every iteration of the model
         void JumpToSample(int n);
         void RemoveListener(int idx, double* listener);
+        void SetSeed(uint32_t seed) { _seed = seed; } //For inputs assigned after this
 
         size_t NumInputs() const { return _inputs.size(); }
+        uint32_t Seed() const { return _seed; }
         Input::TYPE Type(size_t i) const;
 //        double* Value(size_t i) const;
 
@@ -34,11 +36,13 @@ class InputMgr
         const InputMgr* operator*(const ModelMgr*) = delete;
 #endif
         static InputMgr* _instance;
+        static const uint32_t DEFAULT_SEED;
 
         int EmplaceInput(double* data, int idx);
 
         std::vector<Input> _inputs;
         ModelMgr* const _modelMgr;
+        uint32_t _seed;
         std::vector<int> _stepCts;
 };
 
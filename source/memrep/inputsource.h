@@ -0,0 +1,34 @@
+#ifndef INPUTSOURCE_H
+#define INPUTSOURCE_H
+
+#include "../globals/globals.h"
+#include "../globals/log.h"
+#include "../globals/scopetracker.h"
+
+//Where an Input's samples come from
+class InputSource
+{
+    public:
+        virtual ~InputSource() {}
+
+        virtual double Sample(size_t k) = 0;
+            //k < Length().  Only called from the thread stepping the model, and nearly always
+            //with one more than the last k, which sources reading from disk rely on.
+
+        size_t Length() const { return _length; }
+        int SamplesPerUnitTime() const { return _samplesPerUnitTime; }
+
+    protected:
+        InputSource() : _length(0), _samplesPerUnitTime(1) {}
+
+        size_t _length;
+        int _samplesPerUnitTime;
+
+    private:
+#ifdef __GNUG__
+        InputSource(const InputSource&) = delete;
+        InputSource& operator=(const InputSource&) = delete;
+#endif
+};
+
+#endif // INPUTSOURCE_H
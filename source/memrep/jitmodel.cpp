@@ -0,0 +1,114 @@
+#include "jitmodel.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "../generate/object/sharedobj.h"
+#include "../generate/script/cfilejit.h"
+
+const size_t JitModel::MAX_CACHED = 8;
+
+std::deque< std::shared_ptr<JitModel> > JitModel::_cache;
+std::mutex JitModel::_cacheMutex;
+std::atomic<size_t> JitModel::_nameCt(0);
+
+std::shared_ptr<JitModel> JitModel::Request(const std::string& key,
+                                            const ExprnSchedule& schedule)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("JitModel::Request", std::this_thread::get_id());
+#endif
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    auto it = std::find_if(_cache.begin(), _cache.end(), [&](const std::shared_ptr<JitModel>& jm)
+    {
+        return jm->_key == key;
+    });
+    if (it != _cache.end()) return *it;
+
+    std::shared_ptr<JitModel> model( new JitModel(key) );
+    try
+    {
+        //The source has to be written now, while the models still match the key
+        std::unique_ptr<SharedObj> so( new SharedObj(model->_name,
+                                                     new CFileJit(model->_name, schedule)) );
+        model->_files = {so->Name(), so->NameO(), so->NameSO()};
+        so->MakeCFile();
+        model->_isCompiling = true;
+        SharedObj* const so_ptr = so.release();
+        std::thread t( [=]()
+        {
+            try
+            {
+                if (so_ptr->CompileCFile())
+                    Load(model, so_ptr->NameSO());
+                else
+                    model->_log->AddMesg("JitModel::Request: " + ds::StripPath(so_ptr->NameSO())
+                                         + " failed to compile; continuing with the parser.");
+            }
+            catch (std::exception& e)
+            {
+                model->_log->AddExcept("JitModel::Request: " + std::string(e.what()));
+            }
+            delete so_ptr;
+            model->_isCompiling = false;
+        } );
+        t.detach();
+    }
+    catch (std::exception& e)
+    {
+        model->_isCompiling = false;
+        model->_log->AddExcept("JitModel::Request: " + std::string(e.what()));
+    }
+
+    _cache.push_back(model);
+    if (_cache.size()>MAX_CACHED)
+    {
+        auto done = std::find_if(_cache.begin(), _cache.end(), [](const std::shared_ptr<JitModel>& jm)
+        {
+            return !jm->_isCompiling;
+        });
+        if (done != _cache.end()) _cache.erase(done);
+    }
+    return model;
+}
+
+JitModel::~JitModel()
+{
+    _step = nullptr;
+    if (_lib)
+    {
+        _lib->unload();
+        delete _lib;
+    }
+    for (const auto& it : _files)
+        QFile::remove(it.c_str());
+}
+
+JitModel::JitModel(const std::string& key)
+    : _isCompiling(false), _key(key), _lib(nullptr), _log(Log::Instance()), _name(MakeName(key)),
+      _step(nullptr)
+{
+}
+
+void JitModel::Load(std::shared_ptr<JitModel> model, const std::string& so_name)
+{
+    QLibrary* lib = new QLibrary(so_name.c_str());
+    StepFunc step = reinterpret_cast<StepFunc>( lib->resolve(CFileJit::STEP_FUNC.c_str()) );
+    if (!step)
+    {
+        model->_log->AddMesg("JitModel::Load: " + lib->errorString().toStdString()
+                             + "; continuing with the parser.");
+        delete lib;
+        return;
+    }
+    model->_lib = lib;
+    model->_step.store(step, std::memory_order_release);
+    model->_log->AddMesg("Native model " + ds::StripPath(so_name) + " loaded.");
+}
+
+std::string JitModel::MakeName(const std::string& key) const
+{
+    const size_t hash = std::hash<std::string>()(key);
+    return QDir::tempPath().toStdString() + "/dsjit_" + std::to_string(hash)
+            + "_" + std::to_string(_nameCt++) + ".c";
+}
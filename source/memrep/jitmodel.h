@@ -0,0 +1,63 @@
+#ifndef JITMODEL_H
+#define JITMODEL_H
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <QDir>
+#include <QFile>
+#include <QLibrary>
+
+#include "exprnschedule.h"
+#include "../globals/globals.h"
+#include "../globals/log.h"
+#include "../globals/scopetracker.h"
+
+//A natively compiled version of the main ParserMgr expression.  Models are keyed on the
+//parser contents, so every ParserMgr holding the same expressions shares one compilation.
+//The source is written when the model is requested, and compiled on a detached thread; until
+//that finishes (or if it fails) Step() returns nullptr and callers keep using muParser.  The
+//generated files are removed along with the model.
+class JitModel
+{
+    public:
+        typedef void (*StepFunc)(double* const* data, double* const* temp, size_t num_pts);
+
+        static std::shared_ptr<JitModel> Request(const std::string& key,
+                                                 const ExprnSchedule& schedule);
+            //The key has to determine the schedule, as the parser contents do
+
+        ~JitModel();
+
+        inline StepFunc Step() const { return _step.load(std::memory_order_acquire); }
+
+    private:
+        static const size_t MAX_CACHED;
+
+        JitModel(const std::string& key);
+#ifdef __GNUG__
+        JitModel(const JitModel&) = delete;
+        JitModel& operator=(const JitModel&) = delete;
+#endif
+
+        static void Load(std::shared_ptr<JitModel> model, const std::string& so_name);
+        std::string MakeName(const std::string& key) const;
+
+        static std::deque< std::shared_ptr<JitModel> > _cache;
+        static std::mutex _cacheMutex;
+        static std::atomic<size_t> _nameCt;
+            //Each compilation gets its own files, in case an evicted model is requested again
+            //while an earlier copy is still loaded
+
+        VecStr _files; //Generated
+        std::atomic<bool> _isCompiling; //Not evicted until done
+        const std::string _key;
+        QLibrary* _lib;
+        Log* const _log;
+        const std::string _name;
+        std::atomic<StepFunc> _step;
+};
+
+#endif // JITMODEL_H
@@ -0,0 +1,27 @@
+#include "mappedsource.h"
+
+MappedSource::MappedSource(const std::string& file_name, bool wrap)
+    : PrefetchSource(wrap), _file(file_name)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MappedSource::MappedSource", std::this_thread::get_id());
+#endif
+    _length = _file.Samples().Length();
+    _samplesPerUnitTime = _file.SamplesPerUnitTime();
+    StartPrefetch();
+}
+MappedSource::~MappedSource()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("MappedSource::~MappedSource", std::this_thread::get_id());
+#endif
+    StopPrefetch();
+}
+
+void MappedSource::Load(size_t chunk, double* dest, size_t num)
+{
+    const MappedArray& samples = _file.Samples();
+    const size_t first = chunk*CHUNK_SIZE;
+    for (size_t i=0; i<num; ++i)
+        dest[i] = samples[first+i];
+}
@@ -0,0 +1,22 @@
+#ifndef MAPPEDSOURCE_H
+#define MAPPEDSOURCE_H
+
+#include "prefetchsource.h"
+#include "../file/dsinfilein.h"
+
+//A .dsin file, copied out of its mapping a chunk at a time so page faults land on the
+//prefetch thread rather than on the model
+class MappedSource : public PrefetchSource
+{
+    public:
+        MappedSource(const std::string& file_name, bool wrap);
+        virtual ~MappedSource() override;
+
+    protected:
+        virtual void Load(size_t chunk, double* dest, size_t num) override;
+
+    private:
+        const DsinFileIn _file;
+};
+
+#endif // MAPPEDSOURCE_H
@@ -3,6 +3,7 @@
 const std::string ModelMgr::ParVariant::END_NOTES = "###End Notes###";
 
 ModelMgr* ModelMgr::_instance = nullptr;
+const double ModelMgr::TOLERANCE = 1e-6;
 
 ModelMgr* ModelMgr::Instance()
 {
@@ -100,6 +101,11 @@ void ModelMgr::SetCondValue(size_t row, const VecStr& results)
 #endif
     CondModel()->SetResults(row, results);
 }
+void ModelMgr::SetDiffMethod(DIFF_METHOD diff_method)
+{
+    _diffMethod = diff_method;
+    _settingsRevision = ParamModelBase::NextRevision();
+}
 void ModelMgr::SetIsFreeze(ds::PMODEL mi, size_t idx, bool is_freeze)
 {
     _models[mi]->SetFreeze(idx, is_freeze);
@@ -117,6 +123,12 @@ void ModelMgr::SetModel(ds::PMODEL mi, ParamModelBase* model)
     if (_models[mi]) delete _models[mi];
     _models[mi] = model;
 }
+void ModelMgr::SetModelStep(double step)
+{
+    _modelStep = step;
+    _settingsRevision = ParamModelBase::NextRevision();
+        //Euler writes the step into the expressions, and the JIT into the native code
+}
 void ModelMgr::SetNotes(Notes* notes)
 {
     if (_notes) delete _notes;
@@ -169,6 +181,28 @@ bool ModelMgr::AreModelsInitialized() const
 {
     return _models.at(0) != nullptr;
 }
+ModelMgr::ChangeSet ModelMgr::Changes(size_t since) const
+{
+    ChangeSet changes;
+    changes.revision = Revision();
+        //First, so a change made while looking is reported now or next time, never missed
+    changes.is_structural = _settingsRevision>since;
+    for (size_t i=0; i<ds::NUM_MODELS && !changes.is_structural; ++i)
+    {
+        const ParamModelBase* model = _models.at(i);
+        if (!model || model->StructRevision()>since)
+        {
+            changes.is_structural = true;
+            break;
+        }
+        const size_t num_pars = model->NumPars();
+        for (size_t k=0; k<num_pars; ++k)
+            if (model->Revision(k)>since)
+                changes.rows.push_back( std::make_pair((ds::PMODEL)i, k) );
+    }
+    if (changes.is_structural) changes.rows.clear();
+    return changes;
+}
 VecStr ModelMgr::CondResults(size_t row) const
 {
     return CondModel()->Results(row);
@@ -195,6 +229,13 @@ double ModelMgr::Minimum(ds::PMODEL mi, size_t idx) const
 {
     return dynamic_cast<const NumericModelBase*>(_models.at(mi))->Minimum(idx);
 }
+std::string ModelMgr::ModelStepStr() const
+{
+    std::ostringstream ss;
+    ss.precision(17);
+    ss << _modelStep;
+    return ss.str();
+}
 double ModelMgr::Range(ds::PMODEL mi, size_t idx) const
 {
     return Maximum(mi, idx) - Minimum(mi, idx);
@@ -204,8 +245,8 @@ std::string ModelMgr::Value(ds::PMODEL mi, size_t idx) const
     return _models.at(mi)->Value(idx);
 }
 
-ModelMgr::ModelMgr() : _diffMethod(UNKNOWN), _log(Log::Instance()), _models(MakeModelVec()),
-    _notes(nullptr), _tpvModel(nullptr)
+ModelMgr::ModelMgr() : _diffMethod(UNKNOWN), _locateEvents(false), _log(Log::Instance()),
+    _models(MakeModelVec()), _notes(nullptr), _settingsRevision(0), _tpvModel(nullptr)
 {
     CreateModels();
 }
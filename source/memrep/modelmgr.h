@@ -1,6 +1,8 @@
 #ifndef MODELMGR_H
 #define MODELMGR_H
 
+#include <sstream>
+
 #include <QAbstractItemView>
 
 #include "notes.h"
@@ -17,10 +19,20 @@ class ModelMgr
         {
             UNKNOWN = -1,
             EULER,
-            EULER2,
-            RUNGE_KUTTA
+            EULER2, //Heun, see RungeKutta
+            RUNGE_KUTTA, //Classic 4th order, see RungeKutta
+            DORMAND_PRINCE, //Adaptive, see DormandPrince
+            ROSENBROCK //Stiff, see Rosenbrock
         };
 
+        struct ChangeSet
+        {
+            ChangeSet() : is_structural(false), revision(0)
+            {}
+            bool is_structural; //Parameters added or removed, or the diff method or step changed
+            size_t revision; //What the changes bring the caller up to
+            std::vector< std::pair<ds::PMODEL, size_t> > rows; //Values or freeze states
+        };
         struct ParVariant
         {
             ParVariant(const std::string& title) : title(title)
@@ -47,12 +59,13 @@ class ModelMgr
         void InsertParVariant(size_t idx, ParVariant* pv);
 
         void SetCondValue(size_t row, const VecStr& results);
-        void SetDiffMethod(DIFF_METHOD diff_method) { _diffMethod = diff_method; }
+        void SetDiffMethod(DIFF_METHOD diff_method);
         void SetIsFreeze(ds::PMODEL mi, size_t idx, bool is_freeze);
+        void SetLocateEvents(bool locate_events) { _locateEvents = locate_events; }
         void SetMaximum(ds::PMODEL mi, size_t idx, double val);
         void SetMinimum(ds::PMODEL mi, size_t idx, double val);
         void SetModel(ds::PMODEL mi, ParamModelBase* model);
-        void SetModelStep(double step) { _modelStep = step; }
+        void SetModelStep(double step);
         void SetNotes(Notes *notes);
         void SetNotes(const std::string& text);
         void SetParVariants(const std::vector<ParVariant*>& par_variants);
@@ -69,18 +82,30 @@ class ModelMgr
         //Just create getters where a test or actual processing is necessary,
         //OR for symmetry, when there is a corresponding setter
         bool AreModelsInitialized() const;
+        ChangeSet Changes(size_t since) const;
+            //What has changed since revision since, so that only that has to be parsed again
         VecStr CondResults(size_t row) const;
         DIFF_METHOD DiffMethod() const { return _diffMethod; }
         VecStr DiffVarList() const;
         const Notes* GetNotes() const { return _notes; }
         const ParVariant* GetParVariant(size_t i) const { return _parVariants.at(i); }
+        bool HasSolver() const { return _diffMethod!=EULER; }
+            //Whether a DiffSolver steps the differentials, in which case their temporaries
+            //are just derivatives
         bool IsFreeze(ds::PMODEL mi, size_t idx) const;
+        bool LocateEvents() const { return _locateEvents; }
+            //Whether conditions fire where they cross, within a step; see ParserMgr
         double Maximum(ds::PMODEL mi, size_t idx) const;
         double Minimum(ds::PMODEL mi, size_t idx) const;
         inline const ParamModelBase* Model(ds::PMODEL mi) const { return _models.at(mi); }
         inline double ModelStep() const { return _modelStep; }
+        std::string ModelStepStr() const;
+            //At full precision, so that expressions and generated code step exactly alike
         int NumParVariants() const { return _parVariants.size(); }
         double Range(ds::PMODEL mi, size_t idx) const;
+        size_t Revision() const { return ParamModelBase::CurRevision(); }
+        size_t SettingsRevision() const { return _settingsRevision; }
+        double Tolerance() const { return TOLERANCE; } //Absolute and relative, for adaptive steps
         TPVTableModel* TPVModel() { return _tpvModel; }
         std::string Value(ds::PMODEL mi, size_t idx) const;
 
@@ -93,6 +118,7 @@ class ModelMgr
         const ModelMgr* operator*(const ModelMgr*) = delete;
 #endif
         static ModelMgr* _instance;
+        static const double TOLERANCE;
 
         inline ConditionModel* CondModel();
         inline const ConditionModel* CondModel() const;
@@ -100,12 +126,15 @@ class ModelMgr
         std::vector<ParamModelBase*> MakeModelVec() const;
 
         DIFF_METHOD _diffMethod;
+        bool _locateEvents;
         Log* const _log;
         std::vector<ParamModelBase*> _models;
         double _modelStep;
         mutable std::mutex _mutex;
         Notes* _notes;
         std::vector<ParVariant*> _parVariants;
+        std::atomic<size_t> _settingsRevision; //Of the diff method and model step
+            //Set on the GUI thread, read by ParserMgr::Update on the compute thread
         TPVTableModel* _tpvModel;
 };
 
@@ -0,0 +1,150 @@
+#include "modelprogram.h"
+
+const size_t ModelProgram::MAX_CACHED = 8;
+
+std::deque< std::shared_ptr<const ModelProgram> > ModelProgram::_cache;
+std::mutex ModelProgram::_cacheMutex;
+
+std::shared_ptr<const ModelProgram> ModelProgram::Request(const ModelMgr* model_mgr,
+                                                          bool all_outputs,
+                                                          const VecStr& outputs)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("ModelProgram::Request", std::this_thread::get_id());
+#endif
+    const size_t revision = model_mgr->Revision(),
+            settings_revision = model_mgr->SettingsRevision();
+        //First, so that a change made while building makes for a new program next time
+    std::lock_guard<std::mutex> lock(_cacheMutex);
+    auto it = std::find_if(_cache.cbegin(), _cache.cend(),
+                           [&](const std::shared_ptr<const ModelProgram>& mp)
+    {
+        return mp->_revision==revision && mp->_settingsRevision==settings_revision
+                && mp->_allOutputs==all_outputs
+                && (all_outputs || mp->_outputs==outputs);
+    });
+    if (it != _cache.cend()) return *it;
+
+    std::shared_ptr<const ModelProgram> program(
+                new ModelProgram(model_mgr, revision, settings_revision,
+                                 all_outputs, outputs) );
+    _cache.push_back(program);
+    if (_cache.size()>MAX_CACHED) _cache.pop_front();
+    return program;
+}
+
+std::string ModelProgram::EventExprn(const std::string& cond)
+{
+    //Only a single top level comparison, as anything else may not cross continuously
+    int paren = 0;
+    size_t pos = std::string::npos, len = 0;
+    for (size_t i=0; i<cond.size(); ++i)
+    {
+        const char c = cond.at(i);
+        if (c=='(') ++paren;
+        else if (c==')') --paren;
+        if (paren!=0) continue;
+        if (c=='&' || c=='|' || c=='?' || c=='=' || c=='!') return "";
+        if (c!='<' && c!='>') continue;
+        if (pos!=std::string::npos) return "";
+        pos = i;
+        len = (i+1<cond.size() && cond.at(i+1)=='=') ? 2 : 1;
+        i += len-1;
+    }
+    if (pos==std::string::npos) return "";
+    const std::string lhs = cond.substr(0, pos), rhs = cond.substr(pos+len);
+    return (cond.at(pos)=='>') ? "(" + lhs + ")-(" + rhs + ")" : "(" + rhs + ")-(" + lhs + ")";
+}
+
+ModelProgram::ModelProgram(const ModelMgr* model_mgr, size_t revision,
+                           size_t settings_revision, bool all_outputs, const VecStr& outputs)
+    : _allOutputs(all_outputs), _hasJac(false), _numConsts(0), _outputs(outputs),
+      _revision(revision),
+      _schedule(all_outputs ? ExprnSchedule(model_mgr) : ExprnSchedule(model_mgr, outputs)),
+      _settingsRevision(settings_revision)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("ModelProgram::ModelProgram", std::this_thread::get_id());
+#endif
+    //Frozen values are folded in as literals, then what is left constant is hoisted
+    VecStr exprns, consts;
+    auto specialize = [&](const std::string& exprn)
+    {
+        return _schedule.Hoist(_schedule.Specialize(exprn, true, &_folded), consts);
+    };
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+    {
+        const ParamModelBase* model = model_mgr->Model((ds::PMODEL)i);
+        if (!model->DoEvaluate()) continue;
+        const size_t num_pars = model->NumPars();
+        if (model->Id()==ds::VAR)
+        {
+            //Inputs and frozen variables depend on nothing, so they're copied back first,
+            //then the live variables follow the schedule
+            for (size_t k=0; k<num_pars; ++k)
+                if (model->IsFreeze(k))
+                    exprns.push_back(model->TempKey(k) + " = 0");
+            for (size_t k=0; k<num_pars; ++k)
+                if (model->IsFreeze(k) || Input::Type(model->Value(k))!=Input::USER)
+                    exprns.push_back(model->Key(k) + " = " + model->TempKey(k));
+            for (const auto& group : _schedule.VarGroups())
+            {
+                for (auto k : group)
+                    exprns.push_back( specialize(model->TempExpression(k)) );
+                for (auto k : group)
+                    exprns.push_back(model->Key(k) + " = " + model->TempKey(k));
+            }
+            continue;
+        }
+        for (size_t k=0; k<num_pars; ++k)
+            if (model->IsFreeze(k))
+            {
+                std::string freeze_val = (model->Id()==ds::DIFF && !model_mgr->HasSolver())
+                        ? model_mgr->Model(ds::INIT)->Value(k)
+                        : "0"; //With a DiffSolver, differential temporaries are derivatives
+                exprns.push_back( specialize(model->TempKey(k) + " = " + freeze_val) );
+            }
+            else
+            {
+                const std::string exprn = model->TempExpression(k);
+                if (!exprn.empty()) exprns.push_back( specialize(exprn) );
+            }
+    }
+    _exprn = ds::Join(exprns, ", ");
+
+    //Subexpressions of parameters alone are evaluated by their own parser, and only when
+    //the parameters change
+    _numConsts = consts.size();
+    VecStr const_exprns;
+    for (size_t k=0; k<_numConsts; ++k)
+        const_exprns.push_back(ExprnSchedule::ConstKey(k) + " = " + consts[k]);
+    _constExprn = ds::Join(const_exprns, ", ");
+
+    const ParamModelBase* conds = model_mgr->Model(ds::COND);
+    const size_t num_conds = conds->NumPars();
+    _conditions.resize(num_conds);
+    for (size_t k=0; k<num_conds; ++k)
+    {
+        Condition& condition = _conditions[k];
+        condition.cond = conds->Key(k);
+        condition.event = EventExprn(condition.cond);
+        for (const auto& it : model_mgr->CondResults(k))
+            if (!it.empty())
+                condition.results += (condition.results.empty() ? "" : ", ") + it;
+        if (condition.results.empty()) condition.results = "0";
+    }
+
+    const ParamModelBase* jacs = model_mgr->Model(ds::JAC);
+    const size_t num_diffs = model_mgr->Model(ds::DIFF)->NumPars();
+    _hasJac = num_diffs>0 && jacs->NumPars()==num_diffs*num_diffs;
+    for (size_t k=0; _hasJac && k<jacs->NumPars(); ++k)
+        if (jacs->Value(k).empty()) _hasJac = false;
+
+    //The native step addresses parameters by position, so the key has to include the names as
+    //well as the expressions
+    _jitKey = _exprn + "|" + _constExprn;
+        //The hoisted constants' expressions too, since the native step evaluates them inline
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+        _jitKey += "|" + ds::Join(model_mgr->Model((ds::PMODEL)i)->ShortKeys(), ",");
+    _jitKey += "|" + model_mgr->ModelStepStr(); //The native code's tau
+}
@@ -0,0 +1,77 @@
+#ifndef MODELPROGRAM_H
+#define MODELPROGRAM_H
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include "exprnschedule.h"
+#include "modelmgr.h"
+#include "../globals/globals.h"
+#include "../globals/scopetracker.h"
+
+//What a ParserMgr evaluates, built from the models once per revision and shared, read only, by
+//every ParserMgr that asks for the same outputs:  the scheduled, specialized and hoisted main
+//expression, the hoisted constants, and the conditions.  A ParserMgr keeps only its data and
+//the parsers bound to it--muParser binds variables by address, so bytecode can't be shared
+//between them, but it's only compiled from these strings on the first evaluation, and not at
+//all once the native step, shared likewise by JitModel, is loaded.
+class ModelProgram
+{
+    public:
+        struct Condition
+        {
+            std::string cond, event, results;
+                //event:  for locating the crossing, empty if cond isn't a single comparison;
+                //results:  joined, "0" if there are none
+        };
+
+        static std::shared_ptr<const ModelProgram> Request(const ModelMgr* model_mgr,
+                                                           bool all_outputs,
+                                                           const VecStr& outputs);
+            //outputs:  see ExprnSchedule; ignored with all_outputs
+
+        const std::vector<Condition>& Conditions() const { return _conditions; }
+        const std::string& ConstExprn() const { return _constExprn; }
+            //The hoisted constants, assigned to ExprnSchedule::ConstKey
+        const std::string& Exprn() const { return _exprn; }
+        bool Folds(const std::string& key) const { return _folded.count(key)!=0; }
+            //Whether the expressions were specialized on the value of key
+        bool HasJac() const { return _hasJac; }
+            //Whether the Jacobian model has every entry, so solvers can use it
+        const std::string& JitKey() const { return _jitKey; }
+        size_t NumConsts() const { return _numConsts; }
+        const ExprnSchedule& Schedule() const { return _schedule; }
+
+    private:
+        static const size_t MAX_CACHED;
+
+        static std::string EventExprn(const std::string& cond);
+            //The difference of the sides of a comparison, positive when it holds; empty if
+            //cond isn't a single comparison
+
+        ModelProgram(const ModelMgr* model_mgr, size_t revision, size_t settings_revision,
+                     bool all_outputs, const VecStr& outputs);
+#ifdef __GNUG__
+        ModelProgram(const ModelProgram&) = delete;
+        ModelProgram& operator=(const ModelProgram&) = delete;
+#endif
+
+        static std::deque< std::shared_ptr<const ModelProgram> > _cache;
+        static std::mutex _cacheMutex;
+
+        const bool _allOutputs;
+        std::vector<Condition> _conditions;
+        std::string _constExprn, _exprn;
+        std::set<std::string> _folded;
+        bool _hasJac;
+        std::string _jitKey;
+        size_t _numConsts;
+        const VecStr _outputs;
+        const size_t _revision;
+        ExprnSchedule _schedule;
+        const size_t _settingsRevision;
+};
+
+#endif // MODELPROGRAM_H
@@ -1,8 +1,21 @@
 #include "parsermgr.h"
+#include "jitmodel.h"
+
+const int ParserMgr::EVENT_ITERS = 30;
+const double ParserMgr::EVENT_TOL = 1e-9;
+const int ParserMgr::MAX_EVENTS = 8;
+
+#ifdef Q_OS_WIN
+ParserMgr::EVAL_MODE ParserMgr::_defaultEvalMode = ParserMgr::PARSER;
+#else
+ParserMgr::EVAL_MODE ParserMgr::_defaultEvalMode = ParserMgr::NATIVE;
+#endif
 
 ParserMgr::ParserMgr()
-    : _inputMgr(InputMgr::Instance()), _log(Log::Instance()), _modelData( MakeModelData() ),
-      _modelMgr(ModelMgr::Instance())
+    : _allOutputs(true), _batchSize(0), _evalMode(_defaultEvalMode), _hasPending(false),
+      _inputMgr(InputMgr::Instance()), _log(Log::Instance()),
+      _modelData( MakeModelData() ), _modelDataPtrs( MakeModelPtrs(false) ),
+      _modelTempPtrs( MakeModelPtrs(true) ), _modelMgr(ModelMgr::Instance()), _revision(0)
 {
 #ifdef DEBUG_PM_FUNC
     ScopeTracker::InitThread(std::this_thread::get_id());
@@ -10,8 +23,11 @@ ParserMgr::ParserMgr()
 #endif
 }
 ParserMgr::ParserMgr(const ParserMgr& other)
-    : _inputMgr(other._inputMgr), _log(other._log),
-      _modelData( MakeModelData() ), _modelMgr(other._modelMgr)
+    : _allOutputs(other._allOutputs), _batchSize(0), _evalMode(other._evalMode),
+      _hasPending(false), _inputMgr(other._inputMgr), _log(other._log),
+      _modelData( MakeModelData() ), _modelDataPtrs( MakeModelPtrs(false) ),
+      _modelTempPtrs( MakeModelPtrs(true) ), _modelMgr(other._modelMgr),
+      _outputs(other._outputs), _program(other._program), _revision(other._revision)
 {
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::ParserMgr(const ParserMgr&)", std::this_thread::get_id());
@@ -46,11 +62,48 @@ void ParserMgr::AddExpression(const std::string& exprn)
     }
 }
 
+void ParserMgr::BatchBegin(size_t num_pts)
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::BatchBegin", std::this_thread::get_id());
+#endif
+    ApplyPending(); //Between batches, as the sizes can change
+    _batchSize = num_pts;
+    _batchData.resize(ds::NUM_MODELS);
+    _batchTemp.resize(ds::NUM_MODELS);
+    _batchDataPtrs.resize(ds::NUM_MODELS);
+    _batchTempPtrs.resize(ds::NUM_MODELS);
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+    {
+        const size_t num_pars = _modelMgr->Model((ds::PMODEL)i)->NumPars();
+        std::vector<double>& data = _batchData[i],
+                & temp = _batchTemp[i];
+        data.resize(num_pars*num_pts);
+        temp.resize(num_pars*num_pts);
+        //Temporaries are copied too, since that is where inputs are written
+        const double* current = _modelData.at(i).first,
+                * current_temp = _modelData.at(i).second;
+        for (size_t k=0; k<num_pars; ++k)
+        {
+            std::fill_n(data.begin() + k*num_pts, num_pts, current[k]);
+            std::fill_n(temp.begin() + k*num_pts, num_pts, current_temp[k]);
+        }
+        _batchDataPtrs[i] = data.data();
+        _batchTempPtrs[i] = temp.data();
+    }
+    _batchSolvers.clear();
+}
+const double* ParserMgr::BatchData(ds::PMODEL mi, size_t idx) const
+{
+    return &_batchData.at(mi).at(idx*_batchSize);
+}
+
 void ParserMgr::ClearExpressions()
 {
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::ClearExpressions", std::this_thread::get_id());
 #endif
+    _jitModel.reset();
     _parser.SetExpr("");
 }
 
@@ -62,9 +115,12 @@ void ParserMgr::InitData()
     try
     {
         AssociateVars(_parser);
-        AssociateVars(_parserResult);
         for (auto& itp : _parserConds)
             AssociateVars(itp);
+        for (auto& itp : _parserEvents)
+            AssociateVars(itp);
+        for (auto& itp : _parserResults)
+            AssociateVars(itp);
 
         VecStr initializations, expressions;
         for (size_t i=0; i<ds::NUM_MODELS; ++i)
@@ -89,51 +145,26 @@ void ParserMgr::InitData()
         for (const auto& it : initializations)
             QuickEval(it);
 
+        //In dependency order, so each variable starts from the initial values of those it
+        //uses.  But not the differentials, because they need to start at their initialized
+        //value.
         const ParamModelBase* vars = _modelMgr->Model(ds::VAR);
-        const size_t num_vars = vars->NumPars();
-        for (size_t i=0; i<num_vars; ++i)
-            if ( Input::Type(vars->Value(i)) == Input::USER )
-                QuickEval(vars->Expression(i));
-            //This initializes the functions--necessary since they can invoke each other.
-            //But don't do it with differentials because they need to start at their initialized
-            //value
-
-        for (size_t i=0; i<ds::NUM_MODELS; ++i)
-        {
-            const ParamModelBase* model = _modelMgr->Model((ds::PMODEL)i);
-            if (!model->DoInitialize()) continue;
-            double* data = _modelData[i].first,
-                    * temp_data = _modelData[i].second;
-            const size_t num_pars = model->NumPars();
-            for (size_t k=0; k<num_pars; ++k)
-            {
-                const std::string& value = model->Value(k);
+        const ExprnSchedule schedule(_modelMgr);
+        VecStr var_exprns;
+        for (const auto& group : schedule.VarGroups())
+            for (auto k : group)
+                var_exprns.push_back(vars->Expression(k));
+        if (!var_exprns.empty()) QuickEval( ds::Join(var_exprns, ", ") );
 
-                //Assign the source of the data--i.e. attach an input source if needed
-                if (!model->IsFreeze(k))
-                     _inputMgr->AssignInput(&temp_data[k], value, k);
-
-                //Initialize
-                if (model->Id() == ds::INP) // ###
-                    data[k] = temp_data[k] = std::stod(value.c_str());
-            }
-        }
+        AssignInputs();
+        const ParamModelBase* inputs = _modelMgr->Model(ds::INP);
+        const size_t num_inputs = inputs->NumPars();
+        for (size_t k=0; k<num_inputs; ++k)
+            _modelData[ds::INP].first[k] = _modelData[ds::INP].second[k]
+                    = std::stod( inputs->Value(k).c_str() );
 
-        switch (_modelMgr->DiffMethod())
-        {
-            case ModelMgr::UNKNOWN:
-                throw std::runtime_error("ParserMgr::InitData: Bad Diff Method.");
-            case ModelMgr::EULER:
-                break;
-            case ModelMgr::EULER2:
-            case ModelMgr::RUNGE_KUTTA:
-                for (size_t i=0; i<4; ++i)
-                {
-                    std::string ktemp = "__k" + std::to_string(i+1);
-                    _parser.DefineVar(ktemp, _rkTemps+i);
-                }
-                break;
-        }
+        if (_modelMgr->DiffMethod()==ModelMgr::UNKNOWN)
+            throw std::runtime_error("ParserMgr::InitData: Bad Diff Method.");
     }
     catch (mu::ParserError& e)
     {
@@ -145,6 +176,7 @@ void ParserMgr::InitializeFull()
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::InitializeFull", std::this_thread::get_id());
 #endif
+    _revision = _modelMgr->Revision();
     InitData();
     InitParsers();
     SetExpressions();
@@ -189,9 +221,21 @@ void ParserMgr::ParserEval(bool eval_input)
 {
     try
     {
-        std::lock_guard<std::mutex> lock(_mutex);
-        _parser.Eval();
-        TempEval();
+        ApplyPending();
+        if (_solver)
+            SolverEval(*_solver, _modelMgr->ModelStep());
+        else
+        {
+            JitModel::StepFunc step = _jitModel ? _jitModel->Step() : nullptr;
+            if (step)
+                step(_modelDataPtrs.data(), _modelTempPtrs.data(), 1);
+            else
+            {
+                ConstEval();
+                _parser.Eval();
+            }
+            TempEval();
+        }
         if (eval_input) _inputMgr->InputEval();
     }
     catch (mu::ParserError& e)
@@ -201,23 +245,122 @@ void ParserMgr::ParserEval(bool eval_input)
         throw std::runtime_error("Parser error");
     }
 }
-void ParserMgr::ParserEvalAndConds(bool eval_input)
+void ParserMgr::ParserEvalBatch()
 {
-    ParserEval(eval_input);
-
-    const int num_conds = (int)_modelMgr->Model(ds::COND)->NumPars();
-    for (int k=0; k<num_conds; ++k)
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::ParserEvalBatch", std::this_thread::get_id());
+#endif
+    try
     {
-        if (_parserConds.at(k).Eval())
+        BatchApplyPending();
+        if (_batchSize==0) return;
+        JitModel::StepFunc step = _jitModel ? _jitModel->Step() : nullptr;
+        if (step && !_solver)
+        {
+            step(_batchDataPtrs.data(), _batchTempPtrs.data(), _batchSize);
+            BatchTempEval();
+            return;
+        }
+        const ModelMgr::DIFF_METHOD method = _modelMgr->DiffMethod();
+        if (step && (method==ModelMgr::EULER2 || method==ModelMgr::RUNGE_KUTTA))
+        {
+            BatchRungeKutta( _modelMgr->ModelStep() );
+            return;
+        }
+
+        //No native model, or each point needs its own step sizes, so the points are stepped
+        //one at a time, swapping each in and out of the scalar data
+        for (size_t j=0; j<_batchSize; ++j)
         {
-            VecStr cond_results = _modelMgr->CondResults(k);
-            for (const auto& it : cond_results)
+            SwapBatchPoint(j);
+            if (_solver)
+            {
+                if (_batchSolvers.size()!=_batchSize)
+                {
+                    _batchSolvers.resize(_batchSize);
+                    for (auto& it : _batchSolvers)
+                        it = MakeSolver();
+                }
+                SolverEval(*_batchSolvers[j], _modelMgr->ModelStep());
+            }
+            else
             {
-                _parserResult.SetExpr(it);
-                _parserResult.Eval();
+                ConstEval(); //Points may have their own parameters
+                _parser.Eval();
+                TempEval();
             }
+            SwapBatchPoint(j);
+        }
+    }
+    catch (mu::ParserError& e)
+    {
+        _log->AddExcept("ParserMgr::ParserEvalBatch: " + AnnotateErrMsg(e.GetMsg(), _parser)
+                        + "\n" + _parser.GetExpr());
+        throw std::runtime_error("Parser error");
+    }
+}
+void ParserMgr::ParserEvalBatchNoStep()
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::ParserEvalBatchNoStep", std::this_thread::get_id());
+#endif
+    try
+    {
+        BatchApplyPending();
+        if (_batchSize==0) return;
+        JitModel::StepFunc step = _jitModel ? _jitModel->Step() : nullptr;
+        if (step)
+        {
+            step(_batchDataPtrs.data(), _batchTempPtrs.data(), _batchSize);
+            BatchTempEval(false);
+            return;
+        }
+
+        for (size_t j=0; j<_batchSize; ++j)
+        {
+            SwapBatchPoint(j);
+            ConstEval();
+            _parser.Eval();
+            for (size_t i=0; i<ds::NUM_MODELS; ++i)
+                if (i!=ds::DIFF) TempEval((ds::PMODEL)i);
+            SwapBatchPoint(j);
         }
     }
+    catch (mu::ParserError& e)
+    {
+        _log->AddExcept("ParserMgr::ParserEvalBatchNoStep: " + AnnotateErrMsg(e.GetMsg(), _parser)
+                        + "\n" + _parser.GetExpr());
+        throw std::runtime_error("Parser error");
+    }
+}
+void ParserMgr::ParserEvalAndConds(bool eval_input)
+{
+    ApplyPending();
+    const size_t num_conds = _parserConds.size();
+    std::vector<bool> fired(num_conds, false);
+    if (_solver && !_eventConds.empty() && _modelMgr->LocateEvents())
+    {
+        EventEval(fired);
+        if (eval_input) _inputMgr->InputEval();
+    }
+    else
+        ParserEval(eval_input);
+
+    for (size_t k=0; k<num_conds; ++k)
+        if (!fired[k] && _parserConds[k].Eval())
+            _parserResults[k].Eval();
+}
+void ParserMgr::PostData(ds::PMODEL mi, size_t idx, double val)
+{
+    Post( [=]() { SetData(mi, idx, val); } );
+}
+void ParserMgr::PostQuickEval(const std::string& exprn)
+{
+    Post( [=]() { QuickEval(exprn); } );
+}
+void ParserMgr::PostUpdate()
+{
+    Post( [=]() { Update(); } );
 }
 void ParserMgr::QuickEval(const std::string& exprn)
 {
@@ -237,7 +380,6 @@ void ParserMgr::QuickEval(const std::string& exprn)
 #else
     try
     {
-        std::lock_guard<std::mutex> lock(_mutex);
         std::string temp = _parser.GetExpr();
         if (!temp.empty() && std::isspace( temp.back() )) temp.pop_back(); //mu::Parser adds a newline!
         _parser.SetExpr(exprn);
@@ -270,20 +412,87 @@ void ParserMgr::TempEval(ds::PMODEL mi)
     }
 }
 
+void ParserMgr::Update()
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::Update", std::this_thread::get_id());
+#endif
+    const ModelMgr::ChangeSet changes = _modelMgr->Changes(_revision);
+    if (changes.is_structural)
+    {
+        SetExpressions();
+        SetConditions();
+        _revision = changes.revision;
+        return;
+    }
+
+    bool need_exprns = false;
+    std::vector<size_t> conds;
+    for (const auto& it : changes.rows)
+    {
+        if (it.first==ds::COND)
+        {
+            conds.push_back(it.second);
+            if (!_allOutputs) need_exprns = true;
+                //Conditions keep the variables they use live
+        }
+        else if (!IsDataOnly(it.first, it.second))
+            need_exprns = true;
+        else if (it.first==ds::INP)
+            WriteInput(it.second);
+    }
+    if (need_exprns)
+        SetExpressions(); //The main parser is one expression, so all or nothing
+    else if (!conds.empty())
+        _program = ModelProgram::Request(_modelMgr, _allOutputs, _outputs);
+            //The same main expression, with the new conditions
+
+    for (auto k : conds)
+    {
+        if (!_program->Conditions().at(k).event.empty()
+                || std::find(_eventConds.cbegin(), _eventConds.cend(), k)!=_eventConds.cend())
+        {
+            SetConditions(); //The event parsers are indexed by condition
+            break;
+        }
+        SetCondition(k);
+    }
+    _revision = changes.revision;
+}
+
+void ParserMgr::SetBatchData(ds::PMODEL mi, size_t idx, const double* vals)
+{
+    std::copy(vals, vals + _batchSize, _batchData.at(mi).begin() + idx*_batchSize);
+}
+void ParserMgr::SetBatchData(ds::PMODEL mi, size_t idx, double val)
+{
+    std::fill_n(_batchData.at(mi).begin() + idx*_batchSize, _batchSize, val);
+}
 void ParserMgr::SetConditions()
 {
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::SetConditions", std::this_thread::get_id());
 #endif
-    size_t num_conds = _modelMgr->Model(ds::COND)->NumPars();
+    if (!_program) return;
+    const size_t num_conds = _program->Conditions().size();
     _parserConds = std::vector<mu::Parser>(num_conds);
     for (auto& itp : _parserConds)
         AssociateVars(itp);
+    _parserResults = std::vector<mu::Parser>(num_conds);
+    for (auto& itp : _parserResults)
+        AssociateVars(itp);
+    _eventConds.clear();
+    _parserEvents.clear();
 
     for (size_t k=0; k<num_conds; ++k)
     {
-        std::string expr = _modelMgr->Model(ds::COND)->Key(k);
-        _parserConds[k].SetExpr(expr);
+        SetCondition(k);
+        const std::string& event = _program->Conditions().at(k).event;
+        if (event.empty()) continue;
+        _eventConds.push_back(k);
+        _parserEvents.push_back(mu::Parser());
+        AssociateVars(_parserEvents.back());
+        _parserEvents.back().SetExpr(event);
     }
 }
 void ParserMgr::SetData(ds::PMODEL mi, size_t idx, double val)
@@ -293,12 +502,21 @@ void ParserMgr::SetData(ds::PMODEL mi, size_t idx, double val)
 #endif
     _modelData[mi].first[idx] = val;
 }
+void ParserMgr::SetEvalMode(EVAL_MODE eval_mode)
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::SetEvalMode", std::this_thread::get_id());
+#endif
+    _evalMode = eval_mode;
+    RequestJit();
+}
 
 void ParserMgr::SetExpression(const std::string& exprn)
 {
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::SetExpression", std::this_thread::get_id());
 #endif
+    _jitModel.reset();
     _parser.SetExpr(exprn);
 }
 void ParserMgr::SetExpression(const VecStr& exprns)
@@ -306,6 +524,7 @@ void ParserMgr::SetExpression(const VecStr& exprns)
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::SetExpression", std::this_thread::get_id());
 #endif
+    _jitModel.reset();
     _parser.SetExpr("");
     for (const auto& it: exprns)
         AddExpression(it);
@@ -315,34 +534,17 @@ void ParserMgr::SetExpressions()
 #ifdef DEBUG_PM_FUNC
     ScopeTracker st("ParserMgr::SetExpressions", std::this_thread::get_id());
 #endif
-    try
-    {
-        ClearExpressions();
-        for (size_t i=0; i<ds::NUM_MODELS; ++i)
-        {
-            const ParamModelBase* model = _modelMgr->Model((ds::PMODEL)i);
-            if (!model->DoEvaluate()) continue;
-            VecStr temp_expressions = model->TempExpressions();
-            for (const auto& it : temp_expressions)
-                AddExpression(it);
-            const size_t num_pars = model->NumPars();
-            for (size_t k=0; k<num_pars; ++k)
-                if (model->IsFreeze(k))
-                {
-                    std::string freeze_val = (model->Id()==ds::DIFF)
-                            ? _modelMgr->Model(ds::INIT)->Value(k)
-                            : "0";
-                    AddExpression(model->TempKey(k) + " = " + freeze_val);
-                }
-            if (model->Id()==ds::VAR) // ### Really need separate parsers for both here
-                for (size_t k=0; k<num_pars; ++k)
-                    AddExpression(model->Key(k) + " = " + model->TempKey(k));
-        }
-    }
-    catch (mu::ParserError& e)
-    {
-        _log->AddExcept("ParserMgr::SetExpressions: " + std::string(e.GetMsg()));
-    }
+    _program = ModelProgram::Request(_modelMgr, _allOutputs, _outputs);
+    Bind();
+}
+void ParserMgr::SetOutputs(const VecStr& outputs)
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::SetOutputs", std::this_thread::get_id());
+#endif
+    _allOutputs = false;
+    _outputs = outputs;
+    SetExpressions();
 }
 
 const double* ParserMgr::ConstData(ds::PMODEL mi) const
@@ -352,6 +554,10 @@ const double* ParserMgr::ConstData(ds::PMODEL mi) const
 #endif
     return _modelData.at(mi).first;
 }
+bool ParserMgr::IsNative() const
+{
+    return _jitModel && _jitModel->Step();
+}
 double* ParserMgr::Data(ds::PMODEL mi)
 {
 #ifdef DEBUG_PM_FUNC
@@ -378,6 +584,39 @@ std::string ParserMgr::AnnotateErrMsg(const std::string& err_mesg, const mu::Par
     }
     return err_mesg;
 }
+void ParserMgr::ApplyPending()
+{
+    if (!_hasPending.load(std::memory_order_acquire)) return;
+    std::vector< std::function<void()> > pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pending.swap(_pending);
+        _hasPending.store(false, std::memory_order_release);
+    }
+    for (const auto& it : pending)
+        try
+        {
+            it();
+        }
+        catch (std::exception& e)
+        {
+            _log->AddExcept("ParserMgr::ApplyPending: " + std::string(e.what()));
+        }
+}
+void ParserMgr::AssignInputs()
+{
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+    {
+        const ParamModelBase* model = _modelMgr->Model((ds::PMODEL)i);
+        if (!model->DoInitialize()) continue;
+        double* temp_data = _modelData[i].second;
+        const size_t num_pars = model->NumPars();
+        for (size_t k=0; k<num_pars; ++k)
+            if (!model->IsFreeze(k))
+                 _inputMgr->AssignInput(&temp_data[k], model->Value(k), k);
+                    //Attach an input source if needed
+    }
+}
 void ParserMgr::AssociateVars(mu::Parser& parser)
 {
 #ifdef DEBUG_PM_FUNC
@@ -406,6 +645,105 @@ void ParserMgr::AssociateVars(mu::Parser& parser)
         _log->AddExcept("ParserMgr::AssociateVars: " + AnnotateErrMsg(e.GetMsg(), parser));
     }
 }
+void ParserMgr::Bind()
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::Bind", std::this_thread::get_id());
+#endif
+    try
+    {
+        const size_t num_consts = _program->NumConsts();
+        _consts.assign(num_consts, 0);
+        _constInps.assign(_modelMgr->Model(ds::INP)->NumPars(),
+                          std::numeric_limits<double>::quiet_NaN());
+        _parserConsts = mu::Parser();
+        AssociateVars(_parserConsts);
+        for (size_t k=0; k<num_consts; ++k)
+        {
+            const std::string key = ExprnSchedule::ConstKey(k);
+            _parser.DefineVar(key, &_consts[k]);
+            _parserConsts.DefineVar(key, &_consts[k]);
+        }
+        _parserConsts.SetExpr( _program->ConstExprn() );
+        SetExpression( _program->Exprn() );
+
+        _solver = MakeSolver();
+        _eventSolver = MakeSolver();
+        _batchSolvers.clear();
+        RequestJit();
+    }
+    catch (mu::ParserError& e)
+    {
+        _log->AddExcept("ParserMgr::Bind: " + std::string(e.GetMsg()));
+    }
+}
+void ParserMgr::BatchRungeKutta(double dt)
+{
+    //As RungeKutta::Advance with hold, which for a batch costs the same:  each step starts
+    //from a fresh derivative, since SetBatchData may have changed the points since the last
+    const JitModel::StepFunc step = _jitModel->Step();
+    const RungeKutta::METHOD method = (_modelMgr->DiffMethod()==ModelMgr::EULER2)
+            ? RungeKutta::HEUN
+            : RungeKutta::CLASSIC;
+    const int num_stages = RungeKutta::NumStages(method);
+    const double* a = RungeKutta::A(method),
+            * b = RungeKutta::B(method);
+    double* x = _batchData[ds::DIFF].data();
+    const double* f = _batchTemp.at(ds::DIFF).data(); //With a solver, the derivatives
+    const size_t num = _batchData.at(ds::DIFF).size();
+
+    _batchStart.assign(x, x+num);
+    _batchStages.resize(num_stages*num);
+    for (int s=0; s<num_stages; ++s)
+    {
+        for (size_t i=0; s>0 && i<num; ++i)
+        {
+            double sum = 0;
+            for (int j=0; j<s; ++j)
+                sum += a[s*num_stages + j] * _batchStages[j*num + i];
+            x[i] = _batchStart[i] + dt*sum;
+        }
+        step(_batchDataPtrs.data(), _batchTempPtrs.data(), _batchSize);
+        std::copy(f, f+num, _batchStages.begin() + s*num);
+    }
+    for (size_t i=0; i<num; ++i)
+    {
+        double sum = 0;
+        for (int j=0; j<num_stages; ++j)
+            sum += b[j] * _batchStages[j*num + i];
+        x[i] = _batchStart[i] + dt*sum;
+    }
+
+    step(_batchDataPtrs.data(), _batchTempPtrs.data(), _batchSize);
+        //So that everything else is evaluated at the new state
+    BatchTempEval(false);
+}
+void ParserMgr::BatchApplyPending()
+{
+    if (!_hasPending.load(std::memory_order_acquire)) return;
+    ApplyPending();
+    if (_batchData.size()!=ds::NUM_MODELS) return; //No batch yet
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+        if (_batchData.at(i).size() != _modelMgr->Model((ds::PMODEL)i)->NumPars()*_batchSize)
+        {
+            BatchBegin(_batchSize); //The model's shape changed, so the batch starts over
+            break;
+        }
+}
+void ParserMgr::BatchTempEval(bool eval_diffs)
+{
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+        if ((eval_diffs || i!=ds::DIFF) && _modelMgr->Model((ds::PMODEL)i)->DoEvaluate())
+            std::copy(_batchTemp.at(i).cbegin(), _batchTemp.at(i).cend(), _batchData[i].begin());
+}
+void ParserMgr::ConstEval()
+{
+    if (_consts.empty()) return;
+    const double* inps = _modelData.at(ds::INP).first;
+    if (std::equal(_constInps.cbegin(), _constInps.cend(), inps)) return;
+    std::copy(inps, inps + _constInps.size(), _constInps.begin());
+    _parserConsts.Eval();
+}
 void ParserMgr::DeepCopy(const ParserMgr& other)
 {
     for (size_t i=0; i<ds::NUM_MODELS; ++i)
@@ -415,8 +753,119 @@ void ParserMgr::DeepCopy(const ParserMgr& other)
         memcpy(_modelData[i].second, other._modelData.at(i).second, num_pars*sizeof(double));
     }
 
-    InitData();
-    InitParsers();
+    //The data are already initialized, and the program already built
+    AssignInputs();
+    AssociateVars(_parser);
+    if (_program)
+    {
+        Bind();
+        SetConditions();
+    }
+    else
+    {
+        InitParsers();
+        _solver = MakeSolver();
+        _eventSolver = MakeSolver();
+    }
+}
+void ParserMgr::EventEval(std::vector<bool>& fired)
+{
+    try
+    {
+        const size_t num_diffs = _modelMgr->Model(ds::DIFF)->NumPars(),
+                num_events = _eventConds.size();
+        double* diffs = _modelData[ds::DIFF].first;
+        std::vector<double> x0(diffs, diffs+num_diffs), g0(num_events);
+        std::vector<bool> was_true(num_events);
+        auto mark = [&]()
+        {
+            x0.assign(diffs, diffs+num_diffs);
+            for (size_t e=0; e<num_events; ++e)
+            {
+                was_true[e] = _parserConds[_eventConds[e]].Eval()!=0;
+                g0[e] = _parserEvents[e].Eval();
+            }
+        };
+        auto step_from = [&](double h) //Restarts from x0, so the solver carries nothing over
+        {
+            std::copy(x0.cbegin(), x0.cend(), diffs);
+            _eventSolver->Reset();
+            SolverEval(*_eventSolver, h);
+        };
+
+        mark();
+        SolverEval(*_solver, _modelMgr->ModelStep());
+        double left = _modelMgr->ModelStep(); //Of the model step, from x0
+        for (int ct=0; ct<MAX_EVENTS; ++ct)
+        {
+            std::vector<size_t> crossings;
+            std::vector<double> g1;
+            for (size_t e=0; e<num_events; ++e)
+                if (!was_true[e] && _parserConds[_eventConds[e]].Eval())
+                {
+                    crossings.push_back(e);
+                    g1.push_back(_parserEvents[e].Eval());
+                }
+            if (crossings.empty()) break;
+
+            //The earliest crossing, found by regula falsi (the Illinois variant), on g,
+            //the difference of the two sides of the comparison
+            double theta = 1.0;
+            for (size_t i=0; i<crossings.size(); ++i)
+            {
+                const size_t e = crossings[i];
+                double a = 0, b = theta, ga = g0[e], gb = g1[i];
+                if (theta<1.0)
+                {
+                    step_from(theta*left);
+                    if (!_parserConds[_eventConds[e]].Eval()) continue; //Crosses after another
+                    gb = _parserEvents[e].Eval();
+                }
+                int side = 0;
+                for (int it=0; it<EVENT_ITERS && b-a>EVENT_TOL; ++it)
+                {
+                    double c = (gb!=ga) ? (a*gb - b*ga)/(gb - ga) : 0.5*(a+b);
+                    if (!(c>a && c<b)) c = 0.5*(a+b);
+                    step_from(c*left);
+                    const double gc = _parserEvents[e].Eval();
+                    if (_parserConds[_eventConds[e]].Eval())
+                    {
+                        b = c;
+                        gb = gc;
+                        if (side==1) ga *= 0.5;
+                        side = 1;
+                    }
+                    else
+                    {
+                        a = c;
+                        ga = gc;
+                        if (side==-1) gb *= 0.5;
+                        side = -1;
+                    }
+                }
+                theta = b; //The first state found with the condition satisfied
+            }
+
+            //Fire at the crossing, then integrate what's left of the model step
+            step_from(theta*left);
+            for (size_t e=0; e<num_events; ++e)
+            {
+                const size_t k = _eventConds[e];
+                if (was_true[e] || !_parserConds[k].Eval()) continue;
+                _parserResults[k].Eval();
+                fired[k] = true;
+            }
+            left *= 1.0 - theta;
+            mark();
+            if (left<=0) break;
+            step_from(left);
+        }
+    }
+    catch (mu::ParserError& e)
+    {
+        _log->AddExcept("ParserMgr::EventEval: " + AnnotateErrMsg(e.GetMsg(), _parser));
+        throw std::runtime_error("Parser error");
+    }
 }
 std::vector<std::pair<double*, double*> > ParserMgr::MakeModelData()
 {
@@ -431,6 +880,126 @@ std::vector<std::pair<double*, double*> > ParserMgr::MakeModelData()
     }
     return model_data;
 }
+bool ParserMgr::IsDataOnly(ds::PMODEL mi, size_t idx) const
+{
+    switch (mi)
+    {
+        case ds::INP:
+            return !_modelMgr->IsFreeze(mi, idx)
+                    && !Folds( _modelMgr->Model(mi)->ShortKey(idx) );
+                //Frozen or folded means specialized, one way or the other
+        case ds::INIT:
+            return !Folds( _modelMgr->Model(ds::DIFF)->ShortKey(idx) );
+                //Initial conditions are only read at the start, unless a frozen differential
+                //is folded into them
+        default:
+            return false;
+    }
+}
+std::unique_ptr<DiffSolver> ParserMgr::MakeSolver() const
+{
+    const ParamModelBase* vars = _modelMgr->Model(ds::VAR);
+    bool hold = false;
+    for (size_t k=0; k<vars->NumPars(); ++k)
+        if (!vars->IsFreeze(k) && Input::Type(vars->Value(k))!=Input::USER)
+            hold = true;
+        //Inputs change at each model step, so the derivative does too
+    switch (_modelMgr->DiffMethod())
+    {
+        case ModelMgr::EULER2:
+            return std::unique_ptr<DiffSolver>( new RungeKutta(RungeKutta::HEUN, hold) );
+        case ModelMgr::RUNGE_KUTTA:
+            return std::unique_ptr<DiffSolver>( new RungeKutta(RungeKutta::CLASSIC, hold) );
+        case ModelMgr::DORMAND_PRINCE:
+            return std::unique_ptr<DiffSolver>( new DormandPrince(_modelMgr->Tolerance(), hold) );
+        case ModelMgr::ROSENBROCK:
+            return std::unique_ptr<DiffSolver>( new Rosenbrock(hold) );
+        default:
+            return nullptr;
+    }
+}
+std::vector<double*> ParserMgr::MakeModelPtrs(bool is_temp) const
+{
+    std::vector<double*> ptrs(ds::NUM_MODELS);
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+        ptrs[i] = is_temp ? _modelData.at(i).second : _modelData.at(i).first;
+    return ptrs;
+}
+void ParserMgr::Post(const std::function<void()>& cmd)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _pending.push_back(cmd);
+    _hasPending.store(true, std::memory_order_release);
+}
+void ParserMgr::RequestJit()
+{
+#ifdef DEBUG_PM_FUNC
+    ScopeTracker st("ParserMgr::RequestJit", std::this_thread::get_id());
+#endif
+    if (_evalMode==NATIVE && _program && !_program->Exprn().empty())
+        _jitModel = JitModel::Request(_program->JitKey(), _program->Schedule());
+    else
+        _jitModel.reset();
+}
+void ParserMgr::SetCondition(size_t k)
+{
+    const ModelProgram::Condition& condition = _program->Conditions().at(k);
+    _parserConds[k].SetExpr(condition.cond);
+    _parserResults[k].SetExpr(condition.results);
+        //Compiled once here, rather than each time the condition is satisfied
+}
+void ParserMgr::SolverEval(DiffSolver& solver, double dt)
+{
+    ConstEval();
+    JitModel::StepFunc step = _jitModel ? _jitModel->Step() : nullptr;
+    const size_t num_diffs = _modelMgr->Model(ds::DIFF)->NumPars();
+    double* diffs = _modelData[ds::DIFF].first;
+    const double* derivs = _modelData.at(ds::DIFF).second;
+    auto eval = [&](const double* x)
+    {
+        std::copy(x, x+num_diffs, diffs);
+        if (step)
+            step(_modelDataPtrs.data(), _modelTempPtrs.data(), 1);
+        else
+            _parser.Eval();
+    };
+    auto deriv = [&](const double* x, double* dxdt)
+    {
+        eval(x);
+        std::copy(derivs, derivs+num_diffs, dxdt);
+    };
+    auto jac = [&](const double* x, double* J)
+    {
+        if (!_program->HasJac()) return false;
+        eval(x);
+        const double* jacs = _modelData.at(ds::JAC).second;
+        std::copy(jacs, jacs+num_diffs*num_diffs, J);
+        for (size_t i=0; i<num_diffs; ++i)
+            if (_modelMgr->Model(ds::DIFF)->IsFreeze(i))
+                std::fill(J + i*num_diffs, J + (i+1)*num_diffs, 0.0);
+                    //Frozen differentials have zero derivative, whatever their gradient
+        return true;
+    };
+
+    _solverState.assign(diffs, diffs+num_diffs);
+    _solverDeriv.resize(num_diffs);
+    if (!solver.Advance(_solverState.data(), num_diffs, dt, deriv, jac))
+        deriv(_solverState.data(), _solverDeriv.data());
+            //The output was interpolated, so the variables are brought up to date with it
+    std::copy(_solverState.cbegin(), _solverState.cend(), diffs);
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+        if (i!=ds::DIFF) TempEval((ds::PMODEL)i);
+}
+void ParserMgr::SwapBatchPoint(size_t j)
+{
+    for (size_t i=0; i<ds::NUM_MODELS; ++i)
+    {
+        double* data = _modelData[i].first;
+        const size_t num_pars = _batchData.at(i).size() / _batchSize;
+        for (size_t k=0; k<num_pars; ++k)
+            std::swap(data[k], _batchData[i][k*_batchSize + j]);
+    }
+}
 double* ParserMgr::TempData(ds::PMODEL model)
 {
 #ifdef DEBUG_PM_FUNC
@@ -438,4 +1007,19 @@ double* ParserMgr::TempData(ds::PMODEL model)
 #endif
     return _modelData[model].second;
 }
-
+void ParserMgr::WriteInput(size_t idx)
+{
+    const std::string& value = _modelMgr->Model(ds::INP)->Value(idx);
+    try
+    {
+        _modelData[ds::INP].first[idx] = _modelData[ds::INP].second[idx] = std::stod(value);
+    }
+    catch (std::logic_error&)
+    {
+        _log->AddExcept("ParserMgr::WriteInput: Bad value, " + value);
+        return; //Left as it was, until the value is fixed
+    }
+    if (_solver) _solver->Reset(); //Its last derivative is stale
+    for (auto& it : _batchSolvers)
+        if (it) it->Reset();
+}
@@ -1,22 +1,47 @@
 #ifndef PARSERMGR_H
 #define PARSERMGR_H
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
 
 #include <QDebug>
 
 #include <muParser.h>
 
+#include "dormandprince.h"
+#include "exprnschedule.h"
 #include "inputmgr.h"
 #include "modelmgr.h"
+#include "modelprogram.h"
+#include "rosenbrock.h"
+#include "rungekutta.h"
 #include "../globals/scopetracker.h"
 
 //#define DEBUG_PM_FUNC
 
+class JitModel;
+
+//A ParserMgr belongs to the thread that evaluates it, and its evaluation takes no locks.  Other
+//threads, i.e. the GUI, change it only through the Post functions, whose commands that thread
+//applies at the start of its next ParserEval, ParserEvalAndConds, ParserEvalBatch or
+//BatchBegin--so an edit takes effect within one step of being posted.
 class ParserMgr
 {
     public:
+        enum EVAL_MODE
+        {
+            PARSER,
+            NATIVE //Natively compiled model, with the parser as fallback while compiling
+        };
+
+        static EVAL_MODE DefaultEvalMode() { return _defaultEvalMode; }
+        static void SetDefaultEvalMode(EVAL_MODE eval_mode) { _defaultEvalMode = eval_mode; }
+
         ParserMgr();
         ParserMgr(const ParserMgr& other);
 #ifdef __GNUG__
@@ -27,6 +52,11 @@ class ParserMgr
         ~ParserMgr();
 
         void AddExpression(const std::string& exprn);
+        void BatchBegin(size_t num_pts);
+            //Sets up num_pts copies of the model, each starting from the current data, to be
+            //stepped together by ParserEvalBatch.  Batch data is structure-of-arrays:  each
+            //parameter is a contiguous array of num_pts values.
+        const double* BatchData(ds::PMODEL mi, size_t idx) const;
         void ClearExpressions();
         void InitData(); //Initializes the data variables to their appropriate initial values
         void InitializeFull();
@@ -34,40 +64,111 @@ class ParserMgr
         const std::string& ParserContents() const;
         void ParserEval(bool eval_input = true);
         void ParserEvalAndConds(bool eval_input = true);
+            //With ModelMgr::LocateEvents, and a DiffSolver, conditions that are a single
+            //comparison fire where they cross within the step rather than at its end
+        void ParserEvalBatch();
+            //Like ParserEval(false), for every point of the batch; nothing before BatchBegin
+        void ParserEvalBatchNoStep();
+            //Evaluates everything but the differentials at every point of the batch, which stay
+            //where they are:  no step is taken, and no solver is used
+        void PostData(ds::PMODEL mi, size_t idx, double val); //SetData, from another thread
+        void PostQuickEval(const std::string& exprn);
+        void PostUpdate();
         void QuickEval(const std::string& exprn);
         void TempEval();
         void TempEval(ds::PMODEL mi);
+        void Update();
+            //Sets again only what has changed in the models since the last InitializeFull or
+            //Update:  nothing for parameter values, but the expressions if one of them changed,
+            //and just the conditions that did
 
+        void SetBatchData(ds::PMODEL mi, size_t idx, const double* vals);
+        void SetBatchData(ds::PMODEL mi, size_t idx, double val);
         void SetConditions();
         void SetData(ds::PMODEL mi, size_t idx, double val);
             //No range checking
+        void SetEvalMode(EVAL_MODE eval_mode);
         void SetExpression(const std::string& exprn);
         void SetExpression(const VecStr& exprns);
         void SetExpressions();
+        void SetOutputs(const VecStr& outputs);
+            //The variables read from the data, beyond what the model itself needs; by default
+            //all of them.  Variables neither needs aren't evaluated.
 
         const double* ConstData(ds::PMODEL mi) const;
+        EVAL_MODE EvalMode() const { return _evalMode; }
+        bool Folds(const std::string& key) const { return _program && _program->Folds(key); }
+            //Whether the expressions were specialized on the value of key, a frozen parameter,
+            //so that they have to be set again when it changes
+        bool IsNative() const;
 
     private:
+        static const int EVENT_ITERS; //Root finding iterations per crossing
+        static const double EVENT_TOL; //Relative to the step
+        static const int MAX_EVENTS; //Per model step
+        static EVAL_MODE _defaultEvalMode;
+
         std::string AnnotateErrMsg(const std::string& err_mesg, const mu::Parser& parser) const;
+        void ApplyPending(); //The posted commands, in order
+        void AssignInputs(); //Attaches input sources to the data
         void AssociateVars(mu::Parser& parser);
+        void BatchApplyPending(); //Restarts the batch if a posted command changed its shape
+        void BatchRungeKutta(double dt);
+            //Advances the batch data dt with the native step as the derivative, a stage at a
+            //time over every point, for the fixed step solvers
+        void BatchTempEval(bool eval_diffs = true);
+        void Bind(); //Sets the parsers from _program
+        void ConstEval(); //The hoisted constants, if the parameters have changed
         double* Data(ds::PMODEL mi);
         void DeepCopy(const ParserMgr& other);
+        void EventEval(std::vector<bool>& fired); //Steps, firing event conditions as they cross
         std::vector< std::pair<double*, double*> > MakeModelData();
+        bool IsDataOnly(ds::PMODEL mi, size_t idx) const;
+            //Whether a change to the parameter is to data the expressions read, rather than to
+            //the expressions
+        std::unique_ptr<DiffSolver> MakeSolver() const; //Null for the expression diff methods
+        std::vector<double*> MakeModelPtrs(bool is_temp) const;
+        void Post(const std::function<void()>& cmd);
+        void RequestJit();
+        void SetCondition(size_t k); //Not its event parser
+        void SolverEval(DiffSolver& solver, double dt); //Advances the scalar data dt
+        void SwapBatchPoint(size_t j); //Between the scalar data and point j of the batch
         inline double* TempData(ds::PMODEL model);
+        void WriteInput(size_t idx);
 
+        bool _allOutputs;
+        std::vector< std::vector<double> > _batchData, _batchTemp;
+        std::vector<double*> _batchDataPtrs, _batchTempPtrs;
+        size_t _batchSize;
+        std::vector< std::unique_ptr<DiffSolver> > _batchSolvers; //Made as needed
+        std::vector<double> _batchStages, _batchStart; //BatchRungeKutta's k's and starting state
+        std::vector<double> _constInps, _consts;
+            //The hoisted constants, and the parameters they were last evaluated with
+        EVAL_MODE _evalMode;
+        std::unique_ptr<DiffSolver> _eventSolver; //Scratch for EventEval's trial steps
+        std::vector<size_t> _eventConds; //Conditions with a root finding parser in _parserEvents
+        std::atomic<bool> _hasPending; //So that evaluation only locks when there's something
         InputMgr* const _inputMgr;
+        std::shared_ptr<JitModel> _jitModel;
         Log* const _log;
         const std::vector< std::pair<double*, double*> > _modelData;
             //Model evaluation happens in a two-step process so that all variables and differentials
             //can be updated simultaneously; the third element is a temporary that is used for
             //this purpose.
             //  This is an array of pointers to pointers, not a pointer to an array of pointers.
+        const std::vector<double*> _modelDataPtrs, _modelTempPtrs;
+            //Flat views of _modelData for the native step function
         ModelMgr* const _modelMgr;
-        std::mutex _mutex;
-        mu::Parser _parser, _parserResult;
-            //_parserResult is for when conditions get satisfied
-        std::vector<mu::Parser> _parserConds;
-        double _rkTemps[4]; //Runge-Kutta temporary variables
+        std::mutex _mutex; //Of _pending
+        VecStr _outputs;
+        mu::Parser _parser, _parserConsts;
+        std::vector<mu::Parser> _parserConds, _parserEvents, _parserResults;
+            //_parserResults are all the results of each condition, compiled once
+        std::vector< std::function<void()> > _pending;
+        std::shared_ptr<const ModelProgram> _program; //Shared by copies, and equal requests
+        size_t _revision; //Of the models, as of the last InitializeFull or Update
+        std::unique_ptr<DiffSolver> _solver;
+        std::vector<double> _solverDeriv, _solverState;
 };
 
 #endif // PARSERMGR_H
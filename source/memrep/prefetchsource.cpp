@@ -0,0 +1,142 @@
+#include "prefetchsource.h"
+
+const size_t PrefetchSource::CHUNK_SIZE = 64 * 1024;
+const size_t PrefetchSource::NUM_CHUNKS = 4;
+
+PrefetchSource::PrefetchSource(bool wrap)
+    : _cur(nullptr), _curChunk((size_t)-1), _numChunks(0), _slots(NUM_CHUNKS), _stop(false),
+      _want(0), _wrap(wrap)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("PrefetchSource::PrefetchSource", std::this_thread::get_id());
+#endif
+}
+PrefetchSource::~PrefetchSource()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("PrefetchSource::~PrefetchSource", std::this_thread::get_id());
+#endif
+    assert(!_thread.joinable());
+}
+
+void PrefetchSource::StartPrefetch()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("PrefetchSource::StartPrefetch", std::this_thread::get_id());
+#endif
+    _numChunks = (_length + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    for (auto& it : _slots)
+        it.data.resize(CHUNK_SIZE);
+    _thread = std::thread(&PrefetchSource::PrefetchLoop, this);
+}
+void PrefetchSource::StopPrefetch()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("PrefetchSource::StopPrefetch", std::this_thread::get_id());
+#endif
+    if (!_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    _thread.join();
+}
+
+bool PrefetchSource::IsLoaded(size_t chunk) const
+{
+    for (const auto& it : _slots)
+        if (it.chunk==(long long)chunk) return true;
+    return false;
+}
+void PrefetchSource::PrefetchLoop()
+{
+    ds::AddThread(std::this_thread::get_id());
+#ifdef DEBUG_FUNC
+    ScopeTracker::InitThread(std::this_thread::get_id());
+    ScopeTracker st("PrefetchSource::PrefetchLoop", std::this_thread::get_id());
+#endif
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop)
+    {
+        //The first chunk of the window that isn't loaded yet, and a slot outside the window
+        //to load it into
+        long long chunk = -1;
+        for (size_t i=0; i<NUM_CHUNKS && chunk==-1; ++i)
+        {
+            const long long c = WindowChunk(i);
+            if (c!=-1 && !IsLoaded((size_t)c)) chunk = c;
+        }
+        Slot* slot = nullptr;
+        if (chunk!=-1)
+            for (auto& it : _slots)
+            {
+                bool in_window = false;
+                for (size_t i=0; i<NUM_CHUNKS && !in_window; ++i)
+                    in_window = it.chunk!=-1 && it.chunk==WindowChunk(i);
+                if (!in_window)
+                {
+                    slot = &it;
+                    break;
+                }
+            }
+        if (!slot)
+        {
+            _cv.wait(lock);
+            continue;
+        }
+
+        slot->chunk = -1;
+        const size_t num = std::min(CHUNK_SIZE, _length - (size_t)chunk*CHUNK_SIZE);
+        lock.unlock();
+        try
+        {
+            Load((size_t)chunk, slot->data.data(), num);
+        }
+        catch (std::exception& e)
+        {
+            Log::Instance()->AddExcept("PrefetchSource::PrefetchLoop: " + std::string(e.what()));
+            lock.lock();
+            _except = std::current_exception();
+            _cv.notify_all();
+            return;
+        }
+        lock.lock();
+        slot->chunk = chunk;
+        _cv.notify_all();
+    }
+}
+void PrefetchSource::SetChunk(size_t chunk)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _want = chunk;
+    _cv.notify_all();
+
+    //The thread never replaces a chunk in the window, so _cur stays valid until the next call
+    Slot* slot = nullptr;
+    _cv.wait(lock, [&]()
+    {
+        for (auto& it : _slots)
+            if (it.chunk==(long long)chunk)
+            {
+                slot = &it;
+                return true;
+            }
+        return (bool)_except;
+    });
+    if (!slot)
+        throw std::runtime_error("PrefetchSource::SetChunk: Read failed");
+    _cur = slot->data.data();
+    _curChunk = chunk;
+}
+long long PrefetchSource::WindowChunk(size_t i) const
+{
+    if (i>=_numChunks) return -1;
+    size_t chunk = _want + i;
+    if (chunk>=_numChunks)
+    {
+        if (!_wrap) return -1;
+        chunk -= _numChunks;
+    }
+    return (long long)chunk;
+}
@@ -0,0 +1,59 @@
+#ifndef PREFETCHSOURCE_H
+#define PREFETCHSOURCE_H
+
+#include "inputsource.h"
+
+//A source read from disk in chunks by a background thread, which keeps the chunk being read
+//and the NUM_CHUNKS-1 after it loaded, so Sample only waits after a seek.  With wrap set the
+//chunks after the last one are the first ones again.
+//  Derived classes fill in _length and _samplesPerUnitTime and then call StartPrefetch in their
+//constructors, and call StopPrefetch in their destructors, since the thread calls Load.
+class PrefetchSource : public InputSource
+{
+    public:
+        static const size_t CHUNK_SIZE, NUM_CHUNKS;
+
+        virtual ~PrefetchSource() override;
+
+        virtual double Sample(size_t k) override
+        {
+            const size_t chunk = k / CHUNK_SIZE;
+            if (chunk!=_curChunk) SetChunk(chunk);
+            return _cur[k - chunk*CHUNK_SIZE];
+        }
+
+    protected:
+        PrefetchSource(bool wrap);
+
+        virtual void Load(size_t chunk, double* dest, size_t num) = 0;
+            //Called on the prefetch thread, in increasing order of chunk except after a seek
+            //or a wrap
+        void StartPrefetch();
+        void StopPrefetch();
+
+    private:
+        struct Slot
+        {
+            Slot() : chunk(-1) {}
+            long long chunk; //-1 while empty or loading
+            std::vector<double> data;
+        };
+
+        bool IsLoaded(size_t chunk) const;
+        void PrefetchLoop();
+        void SetChunk(size_t chunk);
+        long long WindowChunk(size_t i) const; //-1 past the end
+
+        const double* _cur;
+        size_t _curChunk, _numChunks;
+        std::condition_variable _cv;
+        std::exception_ptr _except;
+        std::mutex _mutex;
+        std::vector<Slot> _slots;
+        bool _stop;
+        std::thread _thread;
+        size_t _want; //The chunk Sample is reading
+        const bool _wrap;
+};
+
+#endif // PREFETCHSOURCE_H
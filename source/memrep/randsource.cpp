@@ -0,0 +1,24 @@
+#include "randsource.h"
+
+RandSource::RandSource(DIST dist, uint32_t seed, uint32_t stream)
+    : _dist(dist), _philox(seed, stream)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("RandSource::RandSource", std::this_thread::get_id());
+#endif
+    _length = std::numeric_limits<size_t>::max();
+}
+
+double RandSource::Sample(size_t k)
+{
+    switch (_dist)
+    {
+        case UNIFORM:
+            return _philox.Uniform(k);
+        case NORMAL:
+            return _philox.Normal(k);
+        case EXPONENTIAL:
+            return _philox.Exponential(k);
+    }
+    return 0;
+}
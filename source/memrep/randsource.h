@@ -0,0 +1,30 @@
+#ifndef RANDSOURCE_H
+#define RANDSOURCE_H
+
+#include <limits>
+
+#include "inputsource.h"
+#include "../globals/philox.h"
+
+//Random samples computed on demand from (seed, stream, k) instead of drawn into a table, so
+//they cost no memory, never repeat, and any stream can be reproduced exactly
+class RandSource : public InputSource
+{
+    public:
+        enum DIST
+        {
+            UNIFORM,
+            NORMAL,
+            EXPONENTIAL
+        }; //Numbered as in the ds_rand_fill written by CFileBase::WriteRandFuncs
+
+        RandSource(DIST dist, uint32_t seed, uint32_t stream);
+
+        virtual double Sample(size_t k) override;
+
+    private:
+        const DIST _dist;
+        const Philox _philox;
+};
+
+#endif // RANDSOURCE_H
@@ -0,0 +1,112 @@
+#include "rosenbrock.h"
+
+const double Rosenbrock::GAMMA = 1.0 + 1.0/std::sqrt(2.0);
+const int Rosenbrock::JAC_REUSE = 16;
+
+Rosenbrock::Rosenbrock(bool hold) : _dt(0), _hold(hold), _isValid(false), _n(0), _stepsSinceJac(0)
+{
+}
+
+bool Rosenbrock::Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                         const JacFunc& jac)
+{
+    if (!_isValid || n!=_n || dt!=_dt || !std::equal(x, x+n, _out.cbegin()))
+        Restart(x, n, dt, deriv);
+    else if (_hold)
+        deriv(x, _f.data());
+
+    if (_stepsSinceJac>=JAC_REUSE)
+    {
+        if (!jac || !jac(x, _lu.data()))
+            FiniteDiffJac(x, deriv);
+        for (size_t i=0; i<n*n; ++i)
+            _lu[i] *= -GAMMA*dt;
+        for (size_t i=0; i<n; ++i)
+            _lu[i*n + i] += 1.0;
+        Factor(_lu.data(), _pivots.data(), n);
+        _stepsSinceJac = 0;
+    }
+
+    //W k1 = f(x), W k2 = f(x + dt*k1) - 2*k1, x += dt*(3/2 k1 + 1/2 k2)
+    _k1 = _f;
+    Solve(_lu.data(), _pivots.data(), n, _k1.data());
+    for (size_t i=0; i<n; ++i)
+        _stage[i] = x[i] + dt*_k1[i];
+    deriv(_stage.data(), _k2.data());
+    for (size_t i=0; i<n; ++i)
+        _k2[i] -= 2.0*_k1[i];
+    Solve(_lu.data(), _pivots.data(), n, _k2.data());
+    for (size_t i=0; i<n; ++i)
+        x[i] += dt*(1.5*_k1[i] + 0.5*_k2[i]);
+
+    deriv(x, _f.data()); //For the next step, and so that everything else is evaluated at x
+    std::copy(x, x+n, _out.begin());
+    ++_stepsSinceJac;
+    return true;
+}
+
+void Rosenbrock::Factor(double* a, int* pivots, size_t n)
+{
+    for (size_t k=0; k<n; ++k)
+    {
+        size_t p = k;
+        for (size_t i=k+1; i<n; ++i)
+            if (std::fabs(a[i*n + k]) > std::fabs(a[p*n + k])) p = i;
+        if (a[p*n + k]==0)
+            throw std::runtime_error("Rosenbrock::Factor: Singular matrix");
+        pivots[k] = (int)p;
+        if (p!=k)
+            for (size_t j=0; j<n; ++j)
+                std::swap(a[k*n + j], a[p*n + j]);
+        for (size_t i=k+1; i<n; ++i)
+        {
+            const double m = (a[i*n + k] /= a[k*n + k]);
+            for (size_t j=k+1; j<n; ++j)
+                a[i*n + j] -= m*a[k*n + j];
+        }
+    }
+}
+void Rosenbrock::Solve(const double* lu, const int* pivots, size_t n, double* b)
+{
+    for (size_t k=0; k<n; ++k)
+        if ((size_t)pivots[k]!=k) std::swap(b[k], b[pivots[k]]);
+    for (size_t i=1; i<n; ++i)
+        for (size_t j=0; j<i; ++j)
+            b[i] -= lu[i*n + j]*b[j];
+    for (size_t i=n; i-->0; )
+    {
+        for (size_t j=i+1; j<n; ++j)
+            b[i] -= lu[i*n + j]*b[j];
+        b[i] /= lu[i*n + i];
+    }
+}
+
+void Rosenbrock::FiniteDiffJac(const double* x, const DerivFunc& deriv)
+{
+    //Forward differences, one column at a time, with _f as f(x)
+    _stage.assign(x, x+_n);
+    for (size_t j=0; j<_n; ++j)
+    {
+        const double dx = std::sqrt(2.2e-16) * std::max(std::fabs(x[j]), 1.0);
+        _stage[j] = x[j] + dx;
+        deriv(_stage.data(), _k2.data());
+        _stage[j] = x[j];
+        for (size_t i=0; i<_n; ++i)
+            _lu[i*_n + j] = (_k2[i] - _f[i]) / dx;
+    }
+}
+void Rosenbrock::Restart(const double* x, size_t n, double dt, const DerivFunc& deriv)
+{
+    _dt = dt;
+    _n = n;
+    _f.resize(n);
+    _k1.resize(n);
+    _k2.resize(n);
+    _lu.resize(n*n);
+    _out.assign(x, x+n);
+    _pivots.resize(n);
+    _stage.resize(n);
+    deriv(x, _f.data());
+    _stepsSinceJac = JAC_REUSE;
+    _isValid = true;
+}
@@ -0,0 +1,46 @@
+#ifndef ROSENBROCK_H
+#define ROSENBROCK_H
+
+#include "diffsolver.h"
+
+//The Rosenbrock-W method ROS2 of Verwer et al.:  linearly implicit, so a step is two linear
+//solves with W = I - GAMMA*dt*J instead of a Newton iteration, and L-stable, so a stiff model
+//can take steps far longer than its fastest time constant.  As a W-method it stays second
+//order with an approximate or outdated Jacobian, which is what lets J, and the LU factorization
+//of W, be reused for JAC_REUSE steps.  Without an analytic Jacobian one is made by finite
+//differences.
+class Rosenbrock : public DiffSolver
+{
+    public:
+        Rosenbrock(bool hold);
+            //hold:  the derivative changes between steps, as it does with inputs, so it is
+            //evaluated again at the start of each
+
+        virtual bool Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                             const JacFunc& jac) override;
+        virtual void Reset() override { _isValid = false; }
+
+        //For generated code, which mirrors Advance
+        static const double GAMMA;
+        static const int JAC_REUSE;
+
+        static void Factor(double* a, int* pivots, size_t n); //In place, with partial pivoting
+        static void Solve(const double* lu, const int* pivots, size_t n, double* b);
+
+    private:
+        void FiniteDiffJac(const double* x, const DerivFunc& deriv);
+        void Restart(const double* x, size_t n, double dt, const DerivFunc& deriv);
+
+        double _dt; //The step the factorization is for
+        std::vector<double> _f; //The derivative at _out
+        const bool _hold;
+        bool _isValid;
+        std::vector<double> _k1, _k2, _stage;
+        std::vector<double> _lu; //W, and then its factorization
+        size_t _n;
+        std::vector<double> _out;
+        std::vector<int> _pivots;
+        int _stepsSinceJac;
+};
+
+#endif // ROSENBROCK_H
@@ -0,0 +1,72 @@
+#include "rungekutta.h"
+
+const double RungeKutta::CLASSIC_A[4*4] = {
+    0, 0, 0, 0,
+    0.5, 0, 0, 0,
+    0, 0.5, 0, 0,
+    0, 0, 1, 0
+};
+const double RungeKutta::CLASSIC_B[4] = {1.0/6.0, 1.0/3.0, 1.0/3.0, 1.0/6.0};
+const double RungeKutta::HEUN_A[2*2] = {
+    0, 0,
+    1, 0
+};
+const double RungeKutta::HEUN_B[2] = {0.5, 0.5};
+
+const double* RungeKutta::A(METHOD method)
+{
+    return (method==HEUN) ? HEUN_A : CLASSIC_A;
+}
+const double* RungeKutta::B(METHOD method)
+{
+    return (method==HEUN) ? HEUN_B : CLASSIC_B;
+}
+int RungeKutta::NumStages(METHOD method)
+{
+    return (method==HEUN) ? 2 : 4;
+}
+
+RungeKutta::RungeKutta(METHOD method, bool hold)
+    : _a(A(method)), _b(B(method)), _hold(hold), _isValid(false), _n(0),
+      _numStages(NumStages(method))
+{
+}
+
+bool RungeKutta::Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                         const JacFunc&)
+{
+    if (!_isValid || n!=_n || !std::equal(x, x+n, _out.cbegin()))
+    {
+        _n = n;
+        _k.resize(_numStages*n);
+        _out.resize(n);
+        _stage.resize(n);
+        _isValid = true;
+        deriv(x, &_k[0]);
+    }
+    else if (_hold)
+        deriv(x, &_k[0]);
+
+    for (int s=1; s<_numStages; ++s)
+    {
+        for (size_t i=0; i<n; ++i)
+        {
+            double sum = 0;
+            for (int j=0; j<s; ++j)
+                sum += _a[s*_numStages + j] * _k[j*n + i];
+            _stage[i] = x[i] + dt*sum;
+        }
+        deriv(_stage.data(), &_k[s*n]);
+    }
+    for (size_t i=0; i<n; ++i)
+    {
+        double sum = 0;
+        for (int j=0; j<_numStages; ++j)
+            sum += _b[j] * _k[j*n + i];
+        x[i] += dt*sum;
+    }
+
+    deriv(x, &_k[0]); //For the next step, and so that everything else is evaluated at x
+    std::copy(x, x+n, _out.begin());
+    return true;
+}
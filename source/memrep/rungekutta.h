@@ -0,0 +1,43 @@
+#ifndef RUNGEKUTTA_H
+#define RUNGEKUTTA_H
+
+#include "diffsolver.h"
+
+//Explicit Runge-Kutta with a fixed step:  each stage evaluates every derivative at the same
+//intermediate state, so the stages are coupled across differentials as the method requires.
+//The derivative at the end of a step is the first stage of the next one, so a step costs
+//NumStages evaluations--unless hold is set, in which case the first stage is redone, since
+//the derivative changes between steps.
+class RungeKutta : public DiffSolver
+{
+    public:
+        enum METHOD
+        {
+            HEUN, //2nd order, Euler2
+            CLASSIC //4th order
+        };
+
+        RungeKutta(METHOD method, bool hold);
+
+        virtual bool Advance(double* x, size_t n, double dt, const DerivFunc& deriv,
+                             const JacFunc&) override;
+        virtual void Reset() override { _isValid = false; }
+
+        //For generated code, which mirrors Advance; A is row major, NumStages by NumStages
+        static const double* A(METHOD method);
+        static const double* B(METHOD method);
+        static int NumStages(METHOD method);
+
+    private:
+        static const double CLASSIC_A[4*4], CLASSIC_B[4], HEUN_A[2*2], HEUN_B[2];
+
+        const double* const _a, * const _b;
+        const bool _hold;
+        bool _isValid;
+        std::vector<double> _k; //Stage derivatives, _numStages rows of _n
+        size_t _n;
+        const int _numStages;
+        std::vector<double> _out, _stage;
+};
+
+#endif // RUNGEKUTTA_H
@@ -0,0 +1,68 @@
+#include "textsource.h"
+
+TextSource::TextSource(const std::string& file_name, bool wrap)
+    : PrefetchSource(wrap), _fileName(file_name), _nextChunk(0)
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("TextSource::TextSource", std::this_thread::get_id());
+#endif
+    _file.open(file_name);
+    if (!_file.is_open()) throw std::runtime_error("TextSource::TextSource: File "
+                                                   + file_name + " failed to open.");
+
+    std::string line;
+    std::getline(_file, line); //Version
+
+    std::getline(_file, line);
+    _samplesPerUnitTime = std::stoi(line);
+
+    std::getline(_file, line);
+    const int num_elts = std::stoi(line);
+    if (num_elts<=0)
+        throw std::runtime_error("TextSource::TextSource: File " + file_name + " has no samples.");
+    _length = num_elts;
+
+    _offsets.push_back(_file.tellg());
+    StartPrefetch();
+}
+TextSource::~TextSource()
+{
+#ifdef DEBUG_FUNC
+    ScopeTracker st("TextSource::~TextSource", std::this_thread::get_id());
+#endif
+    StopPrefetch();
+}
+
+void TextSource::Load(size_t chunk, double* dest, size_t num)
+{
+    if (chunk!=_nextChunk)
+    {
+        const size_t known = std::min(chunk, _offsets.size()-1);
+        _file.clear();
+        _file.seekg(_offsets[known]);
+        _nextChunk = known;
+        while (_nextChunk<chunk)
+            SkipChunk();
+    }
+
+    std::string line;
+    for (size_t i=0; i<num; ++i)
+    {
+        if (!std::getline(_file, line))
+            throw std::runtime_error("TextSource::Load: File " + _fileName + " ends at sample "
+                                     + std::to_string(chunk*CHUNK_SIZE + i));
+        dest[i] = std::stod(line);
+    }
+    ++_nextChunk;
+    if (_offsets.size()==_nextChunk) _offsets.push_back(_file.tellg());
+}
+
+void TextSource::SkipChunk()
+{
+    std::string line;
+    for (size_t i=0; i<CHUNK_SIZE; ++i)
+        if (!std::getline(_file, line))
+            throw std::runtime_error("TextSource::SkipChunk: File " + _fileName + " is short.");
+    ++_nextChunk;
+    if (_offsets.size()==_nextChunk) _offsets.push_back(_file.tellg());
+}
@@ -0,0 +1,28 @@
+#ifndef TEXTSOURCE_H
+#define TEXTSOURCE_H
+
+#include <fstream>
+
+#include "prefetchsource.h"
+
+//A text input file:  the version, the samples per unit time, the number of samples, then one
+//sample per line.  Lines are parsed a chunk at a time on the prefetch thread.
+class TextSource : public PrefetchSource
+{
+    public:
+        TextSource(const std::string& file_name, bool wrap);
+        virtual ~TextSource() override;
+
+    protected:
+        virtual void Load(size_t chunk, double* dest, size_t num) override;
+
+    private:
+        void SkipChunk(); //Reads past the next chunk, recording where the one after starts
+
+        std::ifstream _file;
+        const std::string _fileName;
+        size_t _nextChunk; //Where _file is
+        std::vector<std::streampos> _offsets; //Of every chunk read so far
+};
+
+#endif // TEXTSOURCE_H
@@ -100,6 +100,7 @@ bool ConditionModel::setData(const QModelIndex &index, const QVariant &value, in
                     break;
                 case TEST:
                     Parameter(index.row())->key = val;
+                    Touch(index.row());
                     break;
             }
             break;
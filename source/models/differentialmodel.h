@@ -18,8 +18,6 @@ class DifferentialModel : public NumericModelBase
         virtual std::string TempExprnForCFile(size_t idx) const override;
 
     private:
-        std::string ExprnInsert(const std::string& in, const std::string& exprn,
-                                const std::string& token) const;
         std::string TempExpression(size_t idx, const std::string& model_step) const;
 };
 
@@ -125,6 +125,7 @@ bool JacobianModel::setData(const QModelIndex &index, const QVariant &value, int
 
             int idx = index.row()*columnCount() + index.column();
             Parameter(idx)->value = val;
+            Touch(idx);
             break;
         }
         default:
@@ -8,6 +8,7 @@
 #include "../models/variablemodel.h"
 
 const std::string ParamModelBase::Param::DEFAULT_VAL = "0";
+std::atomic<size_t> ParamModelBase::_revisionCt(0);
 
 ParamModelBase* ParamModelBase::Create(ds::PMODEL mi)
 {
@@ -42,7 +43,7 @@ ParamModelBase* ParamModelBase::Create(ds::PMODEL mi)
 }
 
 ParamModelBase::ParamModelBase(QObject* parent, const std::string& name) :
-    QAbstractTableModel(parent), _id(ds::Model(name))
+    QAbstractTableModel(parent), _id(ds::Model(name)), _structRevision(NextRevision())
 {
 }
 ParamModelBase::~ParamModelBase()
@@ -80,6 +81,11 @@ std::string ParamModelBase::Key(size_t i) const
 {
     return headerData((int)i, Qt::Vertical, Qt::DisplayRole).toString().toStdString();
 }
+size_t ParamModelBase::Revision(size_t i) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _parameters.at(i)->revision;
+}
 VecStr ParamModelBase::Keys() const
 {
     VecStr vs;
@@ -254,6 +260,7 @@ bool ParamModelBase::insertRows(int row, int count, const QModelIndex &parent)
 {
     beginInsertRows(parent, row, row+count-1);
     std::vector<Param*> new_rows(count);
+    _structRevision = NextRevision(); //First, so the new rows are never read as changed values
     _parameters.insert(_parameters.begin()+row, new_rows.begin(), new_rows.end());
     endInsertRows();
     return true;
@@ -262,6 +269,7 @@ bool ParamModelBase::removeRows(int row, int count, const QModelIndex& parent)
 {
     beginRemoveRows(parent, row, row+count-1);
     _parameters.erase(_parameters.begin()+row, _parameters.begin()+row+count);
+    _structRevision = NextRevision();
     endRemoveRows();
     return true;
 }
@@ -297,6 +305,7 @@ bool ParamModelBase::setData(const QModelIndex &index, const QVariant &value, in
                     _parameters[ index.row() ]->value = val;
                     break;
             }
+            _parameters[ index.row() ]->revision = NextRevision(); //Already locked
             break;
         }
         default:
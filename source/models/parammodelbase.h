@@ -4,6 +4,7 @@
 #include <QAbstractTableModel>
 #include <QDebug>
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include <tuple>
@@ -30,19 +31,23 @@ class ParamModelBase : public QAbstractTableModel
         {
             static const std::string DEFAULT_VAL;
             Param()
-                : key(""), value(DEFAULT_VAL), is_freeze(false)
+                : key(""), value(DEFAULT_VAL), is_freeze(false), revision(0)
             {}
             Param(const std::string& k)
-                : key(k), value(DEFAULT_VAL), is_freeze(false)
+                : key(k), value(DEFAULT_VAL), is_freeze(false), revision(0)
             {}
             Param(const std::string& k, const std::string& v)
-                : key(k), value(v), is_freeze(false)
+                : key(k), value(v), is_freeze(false), revision(0)
             {}
             std::string key, value;
             bool is_freeze;
+            size_t revision; //When the value or freeze state last changed
         };
 
         static ParamModelBase* Create(ds::PMODEL mi);
+        static size_t CurRevision() { return _revisionCt; }
+        static size_t NextRevision() { return ++_revisionCt; }
+            //Revisions are shared by every model, so any two changes can be ordered
 
         explicit ParamModelBase(QObject* parent, const std::string& name);
 #ifdef __GNUG__
@@ -61,6 +66,9 @@ class ParamModelBase : public QAbstractTableModel
         ds::PMODEL Id() const { return _id; }
         virtual VecStr Initializations() const { return VecStr(); }
         bool IsFreeze(size_t idx) const;
+        size_t Revision(size_t i) const;
+        size_t StructRevision() const { return _structRevision; }
+            //When parameters were last added or removed
         virtual std::string Key(size_t i) const;
         int KeyIndex(const std::string& par_name) const;
         VecStr Keys() const;
@@ -102,12 +110,22 @@ class ParamModelBase : public QAbstractTableModel
         void SetParameter(int row, Param* parameter) { _parameters[row] = parameter; }
         virtual Param* Parameter(int row) { return _parameters[row]; }
         virtual const Param* Parameter(int row) const { return _parameters.at(row); }
+        void Touch(int row)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _parameters[row]->revision = NextRevision();
+        }
+            //For derived classes that change a parameter's expression outside setData.
+            //Locks, since ParserMgrs read revisions from the worker thread
 
 
     private:
+        static std::atomic<size_t> _revisionCt;
+
         const ds::PMODEL _id;
         mutable std::mutex _mutex;
         std::vector<Param*> _parameters;
+        std::atomic<size_t> _structRevision;
 };
 
 #endif // PARAMMODELBASE_H